@@ -0,0 +1,108 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axbitchunk.h"
+
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+
+enum {
+    AXB_FOREACH_BATCH = 256,
+};
+
+/**
+ * Number of words needed for size chunks, plus a word of padding for the bulk unpacker.
+ */
+static inline uint64_t axb__words__(uint64_t bits, uint64_t size) {
+    return (size * bits + 63) / 64 + 1;
+}
+
+axbitchunk *axb_new(uint64_t bits) {
+    return axb_newSized(bits, 63);
+}
+
+axbitchunk *axb_newSized(uint64_t bits, uint64_t size) {
+    if (!bits || bits > 63)
+        return NULL;
+    size += !size;
+    axbitchunk *b = axc__malloc__(sizeof *b);
+    if (b)
+        b->words = axc__malloc__(axb__words__(bits, size) * sizeof *b->words);
+    if (!b || !b->words) {
+        axc__free__(b);
+        return NULL;
+    }
+    memset(b->words, 0, axb__words__(bits, size) * sizeof *b->words);
+    b->len = 0;
+    b->cap = size;
+    b->bits = bits;
+    b->mask = ((uint64_t) 1 << bits) - 1;
+    return b;
+}
+
+void axb_destroy(axbitchunk *b) {
+    axc__free__(b->words);
+    axc__free__(b);
+}
+
+bool axb_resize(axbitchunk *b, uint64_t size) {
+    size += !size;
+    if (size == b->cap)
+        return false;
+    uint64_t oldWords = axb__words__(b->bits, b->cap);
+    uint64_t newWords = axb__words__(b->bits, size);
+    uint64_t *words = axc__realloc__(b->words, newWords * sizeof *words);
+    if (!words)
+        return true;
+    if (newWords > oldWords)
+        memset(words + oldWords, 0, (newWords - oldWords) * sizeof *words);
+    b->words = words;
+    b->cap = size;
+    b->len = MIN(b->len, size);
+    return false;
+}
+
+bool axb_write(axbitchunk *b, uint64_t i, const uint64_t *values, uint64_t count) {
+    if (i > b->len)
+        return true;
+    if (i + count > b->cap && axb_resize(b, MAX((b->cap << 1) | 1, i + count)))
+        return true;
+    for (uint64_t k = 0; k < count; ++k)
+        axb__store__(b, i + k, values[k]);
+    b->len = MAX(b->len, i + count);
+    return false;
+}
+
+uint64_t axb_read(axbitchunk *b, uint64_t i, uint64_t *values, uint64_t count) {
+    if (i >= b->len)
+        return 0;
+    count = MIN(count, b->len - i);
+    axc__unpackBits__(b->words, i * b->bits, values, count, b->bits);
+    return count;
+}
+
+axbitchunk *axb_foreach(axbitchunk *b, bool (*f)(uint64_t, void *), void *arg) {
+    uint64_t values[AXB_FOREACH_BATCH];
+    for (uint64_t i = 0; i < b->len;) {
+        uint64_t n = axb_read(b, i, values, AXB_FOREACH_BATCH);
+        for (uint64_t k = 0; k < n; ++k) {
+            if (!f(values[k], arg))
+                return b;
+        }
+        i += n;
+    }
+    return b;
+}
+
+axbitchunk *axb_clear(axbitchunk *b) {
+    b->len = 0;
+    return b;
+}
+
+axbitchunk *axb_discard(axbitchunk *b, uint64_t n) {
+    b->len -= MIN(b->len, n);
+    return b;
+}
@@ -0,0 +1,214 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXCHUNK_AXBITCHUNK_H
+#define AXCHUNK_AXBITCHUNK_H
+
+#include "axchunk.h"
+
+/*
+ * axbitchunk is the bit-packed counterpart of axchunk for chunks narrower than a byte or not a whole number of bytes.
+ *
+ * Each chunk is an unsigned integer of 1 to 63 bits ("bits"). The chunks are stored back to back in an array of
+ * 64-bit words without any padding between them, so an array of 3-bit flags uses 3 bits per entry. Chunks are passed in
+ * and out as uint64_t values; bits beyond the chunk width are ignored on input and zero on output.
+ *
+ * The struct definition of axbitchunk is given in its header for optimisation purposes only. To use axbitchunk, you
+ * must rely solely on the functions of the library.
+ */
+typedef struct axbitchunk {
+    uint64_t *words;
+    uint64_t len;
+    uint64_t cap;
+    uint64_t bits;
+    uint64_t mask;
+} axbitchunk;
+
+/**
+ * Creates a new axbitchunk with default capacity.
+ * @param bits Width of individual chunks in bits, from 1 to 63.
+ * @return New axbitchunk or NULL iff OOM or the width is out of range.
+ */
+axbitchunk *axb_new(uint64_t bits);
+
+/**
+ * Creates a new axbitchunk with given capacity.
+ * @param bits Width of individual chunks in bits, from 1 to 63.
+ * @param size Number of chunks to allocate.
+ * @return New axbitchunk or NULL iff OOM or the width is out of range.
+ */
+axbitchunk *axb_newSized(uint64_t bits, uint64_t size);
+
+/**
+ * Destroys the axbitchunk.
+ */
+void axb_destroy(axbitchunk *b);
+
+/**
+ * Sets a new capacity for the axbitchunk.
+ * @param size Number of chunks this axbitchunk should be able to hold at maximum.
+ * @return True iff OOM.
+ */
+bool axb_resize(axbitchunk *b, uint64_t size);
+
+/**
+ * Unsigned number of occupied chunks.
+ * @return Unsigned length of axbitchunk.
+ */
+static inline uint64_t axb_ulen(axbitchunk *b) {
+    return b->len;
+}
+
+/**
+ * Signed number of occupied chunks.
+ * @return Signed length of axbitchunk.
+ */
+static inline int64_t axb_len(axbitchunk *b) {
+    return (int64_t) b->len;
+}
+
+/**
+ * Unsigned maximum number of chunks that can be held without resizing.
+ * @return Unsigned capacity of axbitchunk.
+ */
+static inline uint64_t axb_ucap(axbitchunk *b) {
+    return b->cap;
+}
+
+/**
+ * Width of each individual chunk in bits.
+ * @return Chunk width of an axbitchunk.
+ */
+static inline uint64_t axb_bits(axbitchunk *b) {
+    return b->bits;
+}
+
+/**
+ * Pointer to the packed words of this axbitchunk. Chunk i occupies the bits i * bits to (i + 1) * bits - 1, counting
+ * from the least significant bit of the first word.
+ * @return Internal array of this axbitchunk.
+ */
+static inline uint64_t *axb_data(axbitchunk *b) {
+    return b->words;
+}
+
+/**
+ * This is an internal function of the axchunk library.
+ * Same as axb_get, but without bounds checking.
+ */
+static inline uint64_t axb__load__(axbitchunk *b, uint64_t i) {
+    uint64_t bit = i * b->bits;
+    uint64_t shift = bit & 63;
+    uint64_t v = b->words[bit >> 6] >> shift;
+    if (shift + b->bits > 64)
+        v |= b->words[(bit >> 6) + 1] << (64 - shift);
+    return v & b->mask;
+}
+
+/**
+ * This is an internal function of the axchunk library.
+ * Same as axb_set, but without bounds checking.
+ */
+static inline void axb__store__(axbitchunk *b, uint64_t i, uint64_t value) {
+    uint64_t bit = i * b->bits;
+    uint64_t shift = bit & 63;
+    value &= b->mask;
+    b->words[bit >> 6] = (b->words[bit >> 6] & ~(b->mask << shift)) | value << shift;
+    if (shift + b->bits > 64) {
+        uint64_t spill = 64 - shift;
+        b->words[(bit >> 6) + 1] = (b->words[(bit >> 6) + 1] & ~(b->mask >> spill)) | value >> spill;
+    }
+}
+
+/**
+ * Get the i-th chunk of an axbitchunk.
+ * @param i Index of chunk.
+ * @return Value of chunk or zero if index out of range.
+ */
+static inline uint64_t axb_get(axbitchunk *b, uint64_t i) {
+    return i < b->len ? axb__load__(b, i) : 0;
+}
+
+/**
+ * Push a chunk to the end of an axbitchunk. This operation may resize the axbitchunk.
+ * @param value Value of the chunk. Bits beyond the chunk width are ignored.
+ * @return True iff OOM, in which case nothing is done.
+ */
+static inline bool axb_push(axbitchunk *b, uint64_t value) {
+    if (b->len >= b->cap && axb_resize(b, (b->cap << 1) | 1))
+        return true;
+    axb__store__(b, b->len++, value);
+    return false;
+}
+
+/**
+ * Pop the last chunk off the end of an axbitchunk.
+ * @return Value of the removed chunk or zero if there are no chunks occupied.
+ */
+static inline uint64_t axb_pop(axbitchunk *b) {
+    return b->len ? axb__load__(b, --b->len) : 0;
+}
+
+/**
+ * Set the i-th chunk. If i is equal to the length, the chunk is simply pushed. If i points to an occupied chunk, that
+ * chunk is overwritten. Otherwise the function fails and does nothing.
+ * @param i Index of chunk to overwrite.
+ * @param value Value of the chunk. Bits beyond the chunk width are ignored.
+ * @return True if index out of range or OOM.
+ */
+static inline bool axb_set(axbitchunk *b, uint64_t i, uint64_t value) {
+    if (i > b->len)
+        return true;
+    if (i == b->len)
+        return axb_push(b, value);
+    axb__store__(b, i, value);
+    return false;
+}
+
+/**
+ * Write an arbitrary amount of unpacked chunks into an axbitchunk at some index. If the requested chunks to be
+ * overwritten don't exist, the axbitchunk is resized appropriately.
+ * @param i Index at which to start overwriting chunks. Must not exceed the length.
+ * @param values Chunk source of one uint64_t per chunk.
+ * @param count Number of chunks to write.
+ * @return True if index out of range or OOM.
+ */
+bool axb_write(axbitchunk *b, uint64_t i, const uint64_t *values, uint64_t count);
+
+/**
+ * Read an arbitrary amount of chunks at some index and unpack them into an array of uint64_t. If the requested chunks
+ * are unoccupied or don't exist, less than the specified amount of chunks will be read.
+ * @param i Index at which to start reading chunks.
+ * @param values Chunk destination of one uint64_t per chunk.
+ * @param count Number of chunks to read.
+ * @return The actual amount of chunks read.
+ */
+uint64_t axb_read(axbitchunk *b, uint64_t i, uint64_t *values, uint64_t count);
+
+/**
+ * Let f be a function taking (value of chunk, optional argument).
+ * Call f(x, arg) on each chunk x until f returns false or all chunks have been exhausted. Chunks are unpacked in bulk
+ * and iterated from first to last.
+ * @param f Function to call on all chunks.
+ * @param arg An optional argument passed to the function.
+ * @return Self.
+ */
+axbitchunk *axb_foreach(axbitchunk *b, bool (*f)(uint64_t, void *), void *arg);
+
+/**
+ * Remove every chunk and set the length to zero.
+ * @return Self.
+ */
+axbitchunk *axb_clear(axbitchunk *b);
+
+/**
+ * Remove the last n chunks.
+ * @param n Number of chunks to discard. This is automatically clamped to the number of chunks occupied.
+ * @return Self.
+ */
+axbitchunk *axb_discard(axbitchunk *b, uint64_t n);
+
+#endif //AXCHUNK_AXBITCHUNK_H
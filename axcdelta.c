@@ -0,0 +1,243 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axcdelta.h"
+
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+
+/**
+ * Header of a block: its first key, the bit offset of its packed differences and their bit width.
+ */
+struct axdblock {
+    uint64_t base;
+    uint64_t bitOffset;
+    uint64_t bits;
+};
+
+static inline uint64_t axd__loadKey__(const char *chunk, uint64_t keyWidth) {
+    if (keyWidth == 4) {
+        uint32_t key;
+        memcpy(&key, chunk, 4);
+        return key;
+    }
+    uint64_t key;
+    memcpy(&key, chunk, 8);
+    return key;
+}
+
+static inline void axd__storeKey__(char *chunk, uint64_t key, uint64_t keyWidth) {
+    if (keyWidth == 4) {
+        uint32_t k = (uint32_t) key;
+        memcpy(chunk, &k, 4);
+    } else {
+        memcpy(chunk, &key, 8);
+    }
+}
+
+static inline uint64_t axd__blockChunks__(axcdelta *d, uint64_t block) {
+    return MIN((uint64_t) AXD_BLOCK_LEN, d->len - block * AXD_BLOCK_LEN);
+}
+
+/**
+ * Decodes the keys of a block. The differences are unpacked in bulk and then summed up from the base.
+ */
+static void axd__decodeBlock__(axcdelta *d, uint64_t block, uint64_t *keys) {
+    const struct axdblock *b = &d->blocks[block];
+    const uint64_t n = axd__blockChunks__(d, block);
+    axc__unpackBits__(d->words, b->bitOffset, keys, n, b->bits);
+    uint64_t key = b->base;
+    for (uint64_t k = 0; k < n; ++k) {
+        key += keys[k];
+        keys[k] = key;
+    }
+}
+
+/**
+ * Keys of a block, decoded into the cache if it does not hold them already.
+ */
+static const uint64_t *axd__cachedBlock__(axcdelta *d, uint64_t block) {
+    if (d->cachedBlock != block) {
+        axd__decodeBlock__(d, block, d->cache);
+        d->cachedBlock = block;
+    }
+    return d->cache;
+}
+
+axcdelta *axd_new(axchunk *c, uint64_t keyWidth) {
+    if ((keyWidth != 4 && keyWidth != 8) || keyWidth > c->width)
+        return NULL;
+    axcdelta *d = axc__malloc__(sizeof *d);
+    if (!d)
+        return NULL;
+    d->len = c->len;
+    d->width = c->width;
+    d->keyWidth = keyWidth;
+    d->nblocks = (c->len + AXD_BLOCK_LEN - 1) / AXD_BLOCK_LEN;
+    d->cachedBlock = UINT64_MAX;
+    d->words = NULL;
+    d->payload = NULL;
+    d->blocks = axc__malloc__((d->nblocks + !d->nblocks) * sizeof *d->blocks);
+    d->cache = axc__malloc__(AXD_BLOCK_LEN * sizeof *d->cache);
+    if (!d->blocks || !d->cache)
+        goto fail;
+
+    // first pass: check monotonicity and find the bit width of every block
+    uint64_t totalBits = 0;
+    uint64_t prev = 0;
+    for (uint64_t block = 0; block < d->nblocks; ++block) {
+        const uint64_t first = block * AXD_BLOCK_LEN;
+        const uint64_t n = axd__blockChunks__(d, block);
+        uint64_t maxDelta = 0;
+        for (uint64_t k = 0; k < n; ++k) {
+            uint64_t key = axd__loadKey__((char *) c->chunks + (first + k) * c->width, keyWidth);
+            if (first + k && key < prev)
+                goto fail;
+            if (k)
+                maxDelta |= key - prev;
+            else
+                d->blocks[block].base = key;
+            prev = key;
+        }
+        uint64_t bits = maxDelta ? 64 - (uint64_t) __builtin_clzll(maxDelta) : 0;
+        d->blocks[block].bits = bits;
+        d->blocks[block].bitOffset = totalBits;
+        totalBits += bits * n;
+    }
+
+    // second pass: pack the differences, followed by a word of padding for the decoder
+    d->nwords = (totalBits + 63) / 64 + 1;
+    d->words = axc__malloc__(d->nwords * sizeof *d->words);
+    if (!d->words)
+        goto fail;
+    memset(d->words, 0, d->nwords * sizeof *d->words);
+    for (uint64_t block = 0; block < d->nblocks; ++block) {
+        const uint64_t first = block * AXD_BLOCK_LEN;
+        const uint64_t n = axd__blockChunks__(d, block);
+        prev = d->blocks[block].base;
+        for (uint64_t k = 0; k < n; ++k) {
+            uint64_t key = axd__loadKey__((char *) c->chunks + (first + k) * c->width, keyWidth);
+            d->cache[k] = key - prev;
+            prev = key;
+        }
+        axc__packBits__(d->words, d->blocks[block].bitOffset, d->cache, n, d->blocks[block].bits);
+    }
+
+    if (c->width > keyWidth) {
+        d->payload = axc_newSized(c->width - keyWidth, c->len);
+        if (!d->payload)
+            goto fail;
+        char *dst = d->payload->chunks;
+        for (uint64_t i = 0; i < c->len; ++i) {
+            memcpy(dst, (char *) c->chunks + i * c->width + keyWidth, c->width - keyWidth);
+            dst += c->width - keyWidth;
+        }
+        d->payload->len = c->len;
+    }
+    return d;
+
+fail:
+    axd_destroy(d);
+    return NULL;
+}
+
+void axd_destroy(axcdelta *d) {
+    if (d->payload)
+        axc_destroy(d->payload);
+    axc__free__(d->blocks);
+    axc__free__(d->words);
+    axc__free__(d->cache);
+    axc__free__(d);
+}
+
+uint64_t axd_key(axcdelta *d, uint64_t i) {
+    if (i >= d->len)
+        return 0;
+    return axd__cachedBlock__(d, i / AXD_BLOCK_LEN)[i % AXD_BLOCK_LEN];
+}
+
+void *axd_get(axcdelta *d, uint64_t i, void *dest) {
+    if (i >= d->len)
+        return dest;
+    axd__storeKey__(dest, axd_key(d, i), d->keyWidth);
+    if (d->payload)
+        memcpy((char *) dest + d->keyWidth, axc_index(d->payload, i), d->payload->width);
+    return dest;
+}
+
+uint64_t axd_readKeys(axcdelta *d, uint64_t i, uint64_t *keys, uint64_t count) {
+    if (i >= d->len)
+        return 0;
+    count = MIN(count, d->len - i);
+    for (uint64_t left = count; left;) {
+        const uint64_t block = i / AXD_BLOCK_LEN;
+        const uint64_t offset = i % AXD_BLOCK_LEN;
+        const uint64_t n = MIN(left, axd__blockChunks__(d, block) - offset);
+        if (!offset && n == axd__blockChunks__(d, block))
+            axd__decodeBlock__(d, block, keys);
+        else
+            memcpy(keys, axd__cachedBlock__(d, block) + offset, n * sizeof *keys);
+        keys += n;
+        i += n;
+        left -= n;
+    }
+    return count;
+}
+
+uint64_t axd_read(axcdelta *d, uint64_t i, void *chunks, uint64_t chkcount) {
+    if (i >= d->len)
+        return 0;
+    chkcount = MIN(chkcount, d->len - i);
+    uint64_t keys[AXD_BLOCK_LEN];
+    char *out = chunks;
+    for (uint64_t done = 0; done < chkcount;) {
+        uint64_t n = axd_readKeys(d, i + done, keys, MIN((uint64_t) AXD_BLOCK_LEN, chkcount - done));
+        for (uint64_t k = 0; k < n; ++k) {
+            axd__storeKey__(out, keys[k], d->keyWidth);
+            if (d->payload)
+                memcpy(out + d->keyWidth, axc_index(d->payload, i + done + k), d->payload->width);
+            out += d->width;
+        }
+        done += n;
+    }
+    return chkcount;
+}
+
+uint64_t axd_lowerBound(axcdelta *d, uint64_t key) {
+    // find the first block whose base is not less than the key; the bound lies in the block before it or at its start
+    uint64_t lo = 0, hi = d->nblocks;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (d->blocks[mid].base < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (!lo)
+        return 0;
+    const uint64_t block = lo - 1;
+    const uint64_t *keys = axd__cachedBlock__(d, block);
+    const uint64_t n = axd__blockChunks__(d, block);
+    for (uint64_t k = 0; k < n; ++k) {
+        if (keys[k] >= key)
+            return block * AXD_BLOCK_LEN + k;
+    }
+    return MIN(lo * AXD_BLOCK_LEN, d->len);
+}
+
+uint64_t axd_storageSize(axcdelta *d) {
+    uint64_t size = d->nblocks * sizeof *d->blocks + d->nwords * sizeof *d->words;
+    if (d->payload)
+        size += d->payload->len * d->payload->width;
+    return size;
+}
+
+axchunk *axd_toAxchunk(axcdelta *d) {
+    axchunk *c = axc_newSized(d->width, d->len);
+    if (!c)
+        return NULL;
+    c->len = axd_read(d, 0, c->chunks, d->len);
+    return c;
+}
@@ -0,0 +1,128 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXCHUNK_AXCDELTA_H
+#define AXCHUNK_AXCDELTA_H
+
+#include "axchunk.h"
+
+/*
+ * axcdelta is a compact, read-only encoding of an axchunk whose chunks start with a monotonic unsigned integer key.
+ *
+ * The keys are split into blocks of AXD_BLOCK_LEN keys. Every block stores its first key as its base and the
+ * differences between consecutive keys bit-packed with the smallest bit width that fits the largest difference of the
+ * block. Sorted identifiers with small gaps therefore shrink to a few bits per key. The rest of every chunk, if any,
+ * is kept in a plain axchunk.
+ *
+ * Random access goes through the block headers and decodes a single block, which is cached until another block is
+ * accessed. Bulk reads decode whole blocks at once.
+ *
+ * The struct definition of axcdelta is given in its header for optimisation purposes only. To use axcdelta, you must
+ * rely solely on the functions of the library.
+ */
+typedef struct axcdelta {
+    struct axdblock *blocks;
+    uint64_t nblocks;
+    uint64_t *words;
+    uint64_t nwords;
+    uint64_t len;
+    uint64_t width;
+    uint64_t keyWidth;
+    axchunk *payload;
+    uint64_t cachedBlock;
+    uint64_t *cache;
+} axcdelta;
+
+/**
+ * Number of keys per block.
+ */
+#define AXD_BLOCK_LEN 128
+
+/**
+ * Encode an axchunk whose chunks start with a monotonically non-decreasing unsigned integer key in host byte order.
+ * The axchunk is left untouched.
+ * @param keyWidth Size of the key, either 4 or 8 bytes. Must not exceed the chunk width.
+ * @return New axcdelta or NULL iff the keys are not monotonic, the key width is invalid or OOM.
+ */
+axcdelta *axd_new(axchunk *c, uint64_t keyWidth);
+
+/**
+ * Destroys the axcdelta.
+ */
+void axd_destroy(axcdelta *d);
+
+/**
+ * Unsigned number of encoded chunks.
+ * @return Unsigned length of axcdelta.
+ */
+static inline uint64_t axd_ulen(axcdelta *d) {
+    return d->len;
+}
+
+/**
+ * Size of each individual decoded chunk.
+ * @return Chunk width of an axcdelta.
+ */
+static inline uint64_t axd_width(axcdelta *d) {
+    return d->width;
+}
+
+/**
+ * Get the key of the i-th chunk.
+ * @param i Index of chunk.
+ * @return Key of chunk or zero if index out of range.
+ */
+uint64_t axd_key(axcdelta *d, uint64_t i);
+
+/**
+ * Decode the i-th chunk, i.e. its key followed by the rest of the chunk, into the memory buffer dest.
+ * Does nothing when index is out of range.
+ * @param i Index of chunk to decode.
+ * @param dest Pointer to buffer where the chunk will be written into.
+ * @return The destination pointer.
+ */
+void *axd_get(axcdelta *d, uint64_t i, void *dest);
+
+/**
+ * Decode the keys of an arbitrary amount of chunks at some index. If the requested chunks don't exist, less than the
+ * specified amount of keys will be decoded.
+ * @param i Index at which to start decoding keys.
+ * @param keys Key destination.
+ * @param count Number of keys to decode.
+ * @return The actual amount of keys decoded.
+ */
+uint64_t axd_readKeys(axcdelta *d, uint64_t i, uint64_t *keys, uint64_t count);
+
+/**
+ * Decode an arbitrary amount of whole chunks at some index. If the requested chunks don't exist, less than the
+ * specified amount of chunks will be decoded.
+ * @param i Index at which to start decoding chunks.
+ * @param chunks Chunk destination.
+ * @param chkcount Number of chunks to decode.
+ * @return The actual amount of chunks decoded.
+ */
+uint64_t axd_read(axcdelta *d, uint64_t i, void *chunks, uint64_t chkcount);
+
+/**
+ * Find the first chunk whose key is not less than the given key. O(log n).
+ * @param key Key to search for.
+ * @return Index of the chunk or the length of the axcdelta if every key is less than the given key.
+ */
+uint64_t axd_lowerBound(axcdelta *d, uint64_t key);
+
+/**
+ * Number of bytes used by the encoding, including the rest of the chunks.
+ * @return Storage size in bytes.
+ */
+uint64_t axd_storageSize(axcdelta *d);
+
+/**
+ * Decode all chunks into a new axchunk.
+ * @return New axchunk or NULL iff OOM.
+ */
+axchunk *axd_toAxchunk(axcdelta *d);
+
+#endif //AXCHUNK_AXCDELTA_H
@@ -8,14 +8,97 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 
+#define _GNU_SOURCE
 #include "axchunk.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define AXC_IO_URING
+#endif
+#endif
+
+/*
+ * AXC_AVX2 is defined where the AVX2 kernels are compiled. Unless the whole build targets AVX2, they are compiled for
+ * it with AXC_TARGET_AVX2 and only called once axc__hasAVX2__ has checked the processor at run time.
+ */
+#if defined(__AVX2__)
+#define AXC_AVX2
+#define AXC_TARGET_AVX2
+#elif defined(__SSE2__) && defined(__GNUC__)
+#define AXC_AVX2
+#define AXC_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
 
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
 #define MAX(x,y) ((x) > (y) ? (x) : (y))
 
+enum {
+    AXC_FILE_VERSION = 1,
+    AXC_FILE_ALIGNMENT = 4096,
+    AXC_FILE_UNCHECKED = 1,
+    AXC_EXTENT_SIZE = 8 << 20,
+    AXC_JOB_THREADS = 4,
+    AXC_MAX_THREADS = 64,
+    AXC_PARALLEL_BYTES = 1 << 20,
+    AXC_PARTITION_BYTES = 256 << 10,
+    AXC_MAX_PARTITIONS = 4096,
+    AXC_TABLE_SLOTS = 1024,
+    AXC_BATCH = 256,
+    AXC_FINGERPRINT_BLOCK = 64 << 10,
+    AXC_COMPARE_BLOCK = 4096,
+    AXC_JOURNAL_BATCH = 64 << 10,
+};
+
+static const char axcMagic[8] = "AXCHUNK";
+
+/**
+ * Header of the on-disk format, see axchunk.h.
+ */
+typedef struct axcheader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t width;
+    uint64_t len;
+    uint64_t alignment;
+    uint64_t checksum;
+    uint64_t headerChecksum;
+} axcheader;
+
+/**
+ * A memory mapping backing the internal array of an axchunk. The mapping starts with the file header and the chunks
+ * start at the alignment. Shared mappings keep their file descriptor open, private ones have a negative one.
+ */
+struct axcmapping {
+    void *base;
+    size_t size;
+    uint64_t alignment;
+    int fd;
+};
+
+/**
+ * How many indices ahead random accesses are prefetched by default.
+ */
+#define AXC_PREFETCH_DISTANCE 8
+
 static void *(*malloc_)(size_t) = malloc;
 static void *(*realloc_)(void *, size_t) = realloc;
 static void (*free_)(void *) = free;
+static size_t streamThreshold_ = 0;
+static unsigned threads_ = 0;
+static bool ioUring_ = true;
 
 /**
  * Same as axc_index, but without bounds checking.
@@ -30,6 +113,454 @@ void axc_memoryfn(void *(*malloc_fn)(size_t), void *(*realloc_fn)(void *, size_t
     free_ = free_fn ? free_fn : free;
 }
 
+void *axc__malloc__(size_t size) {
+    return malloc_(size);
+}
+
+void *axc__realloc__(void *ptr, size_t size) {
+    return realloc_(ptr, size);
+}
+
+void axc__free__(void *ptr) {
+    free_(ptr);
+}
+
+void axc_streamThreshold(size_t bytes) {
+    streamThreshold_ = bytes;
+}
+
+void axc_threads(unsigned threads) {
+    threads_ = MIN(threads, AXC_MAX_THREADS);
+}
+
+void axc_ioUring(bool enable) {
+    ioUring_ = enable;
+}
+
+#ifdef AXC_AVX2
+/**
+ * Whether the processor can run functions marked AXC_TARGET_AVX2.
+ */
+static inline bool axc__hasAVX2__(void) {
+#ifdef __AVX2__
+    return true;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+/**
+ * Size of the last level cache or 32 MiB if it cannot be determined. Bulk copies run on worker threads too, so the
+ * cached size is atomic; threads that race to determine it store the same value.
+ */
+static size_t axc__llcSize__(void) {
+    static atomic_size_t llc;
+    size_t cached = atomic_load_explicit(&llc, memory_order_relaxed);
+    if (!cached) {
+        long size = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+        size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+        if (size <= 0)
+            size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+        cached = size > 0 ? (size_t) size : (size_t) 32 << 20;
+        atomic_store_explicit(&llc, cached, memory_order_relaxed);
+    }
+    return cached;
+}
+
+/**
+ * memcpy for bulk copies. Copies at least as large as the stream threshold are done with non-temporal stores that
+ * bypass the cache. The buffers must not overlap.
+ */
+static void *axc__bulkcopy__(void *dst, const void *src, size_t n) {
+#ifdef __SSE2__
+    if (n < 64 || n < (streamThreshold_ ? streamThreshold_ : axc__llcSize__()))
+        return memcpy(dst, src, n);
+    char *d = dst;
+    const char *s = src;
+    size_t head = (16 - ((uintptr_t) d & 15)) & 15;
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+    for (; n >= 64; n -= 64, d += 64, s += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *) s);
+        __m128i b = _mm_loadu_si128((const __m128i *) (s + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *) (s + 32));
+        __m128i e = _mm_loadu_si128((const __m128i *) (s + 48));
+        _mm_stream_si128((__m128i *) d, a);
+        _mm_stream_si128((__m128i *) (d + 16), b);
+        _mm_stream_si128((__m128i *) (d + 32), c);
+        _mm_stream_si128((__m128i *) (d + 48), e);
+    }
+    _mm_sfence();
+    memcpy(d, s, n);
+    return dst;
+#else
+    return memcpy(dst, src, n);
+#endif
+}
+
+/**
+ * memmove for bulk copies, which streams whenever the buffers do not overlap.
+ */
+static void *axc__bulkmove__(void *dst, const void *src, size_t n) {
+    if ((const char *) src + n <= (char *) dst || (char *) dst + n <= (const char *) src)
+        return axc__bulkcopy__(dst, src, n);
+    return memmove(dst, src, n);
+}
+
+static inline uint64_t axc__read64__(const char *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+uint64_t axc__hash__(const void *data, size_t n, uint64_t seed) {
+    static const uint64_t k0 = 0xa0761d6478bd642full, k1 = 0xe7037ed1a0b428dbull, k2 = 0x8ebc6af09c88c6e3ull;
+    const char *p = data;
+    uint64_t h = seed ^ axc__mum__(seed ^ k0, k1) ^ n;
+    uint64_t h1 = h, h2 = h;
+    size_t k = n;
+    for (; k >= 32; k -= 32, p += 32) {
+        h1 = axc__mum__(axc__read64__(p) ^ k1, axc__read64__(p + 8) ^ h1);
+        h2 = axc__mum__(axc__read64__(p + 16) ^ k2, axc__read64__(p + 24) ^ h2);
+    }
+    // the seed is mixed in again for inputs too short for the loop above, where h1 ^ h2 cancels out
+    h = h1 ^ h2 ^ seed;
+    for (; k >= 8; k -= 8, p += 8)
+        h = axc__mum__(axc__read64__(p) ^ k1, h ^ k0);
+    if (k) {
+        uint64_t tail = 0;
+        memcpy(&tail, p, k);
+        h = axc__mum__(tail ^ k2, h ^ k1);
+    }
+    return axc__mum__(h ^ k0, (uint64_t) n ^ k2);
+}
+
+/**
+ * Offset of the chunk array in files written on this machine: 4096 bytes or the page size if that is larger, so that
+ * the chunks of a mapped file start on a page boundary.
+ */
+static uint64_t axc__fileAlignment__(void) {
+    long pageSize = sysconf(_SC_PAGESIZE);
+    return pageSize > AXC_FILE_ALIGNMENT ? (uint64_t) pageSize : AXC_FILE_ALIGNMENT;
+}
+
+/**
+ * Fills in a header for the given chunk array. Without chunks, the header is marked as having no chunk checksum.
+ */
+static void axc__header__(axcheader *header, uint64_t width, uint64_t len, const void *chunks) {
+    memset(header, 0, sizeof *header);
+    memcpy(header->magic, axcMagic, sizeof header->magic);
+    header->version = AXC_FILE_VERSION;
+    header->flags = chunks ? 0 : AXC_FILE_UNCHECKED;
+    header->width = width;
+    header->len = len;
+    header->alignment = axc__fileAlignment__();
+    header->checksum = chunks ? axc__hash__(chunks, width * len, 0) : 0;
+    header->headerChecksum = axc__hash__(header, offsetof(axcheader, headerChecksum), 0);
+}
+
+/**
+ * Checks whether a header is well-formed and describes a file of the given size. Files are always mapped from offset
+ * zero, so any multiple of 4096 is accepted as alignment, even one smaller than the page size of this machine.
+ */
+static bool axc__validHeader__(const axcheader *header, uint64_t fileSize) {
+    return !memcmp(header->magic, axcMagic, sizeof header->magic)
+        && header->version == AXC_FILE_VERSION
+        && header->headerChecksum == axc__hash__(header, offsetof(axcheader, headerChecksum), 0)
+        && header->width
+        && header->alignment
+        && header->alignment % AXC_FILE_ALIGNMENT == 0
+        && header->alignment <= fileSize
+        && header->len <= (fileSize - header->alignment) / header->width;
+}
+
+/**
+ * Writes the current length of a file-backed axchunk into the header of its mapping.
+ */
+static void axc__stampHeader__(axchunk *c) {
+    axcheader *header = c->mapping->base;
+    header->len = c->len;
+    header->headerChecksum = axc__hash__(header, offsetof(axcheader, headerChecksum), 0);
+}
+
+/**
+ * Releases the mapping of an axchunk. A file-backed axchunk records its length in the file first.
+ */
+static void axc__releaseMapping__(axchunk *c) {
+    if (c->mapping->fd >= 0) {
+        axc__stampHeader__(c);
+        munmap(c->mapping->base, c->mapping->size);
+        close(c->mapping->fd);
+    } else {
+        munmap(c->mapping->base, c->mapping->size);
+    }
+    free_(c->mapping);
+    c->mapping = NULL;
+}
+
+/**
+ * Grows or shrinks the file and the shared mapping of a file-backed axchunk. Returns true iff an error occurred.
+ */
+static bool axc__remap__(axchunk *c, uint64_t size) {
+    struct axcmapping *mapping = c->mapping;
+    size_t newSize = (size_t) (mapping->alignment + size * c->width);
+    // the file is resized first, so that failing to resize it leaves everything untouched. Shrinking the file below
+    // the mapping is safe because nothing touches the chunks beyond the new size before the mapping is shrunk as well
+    if (ftruncate(mapping->fd, (off_t) newSize))
+        return true;
+#ifdef MREMAP_MAYMOVE
+    void *base = mremap(mapping->base, mapping->size, newSize, MREMAP_MAYMOVE);
+#else
+    void *base = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, mapping->fd, 0);
+    if (base != MAP_FAILED)
+        munmap(mapping->base, mapping->size);
+#endif
+    if (base == MAP_FAILED) {
+        // the old mapping is still in place, so the file must cover it again. If it cannot, the chunks beyond the
+        // end of the file are gone
+        if (newSize < mapping->size && ftruncate(mapping->fd, (off_t) mapping->size))
+            c->len = MIN(c->len, size);
+        return true;
+    }
+    mapping->base = base;
+    mapping->size = newSize;
+    c->chunks = (char *) base + mapping->alignment;
+    c->cap = size;
+    // chunks beyond the end of the file are gone, so the length recorded in the file must not count them
+    c->len = MIN(c->len, size);
+    return false;
+}
+
+void axc__packBits__(uint64_t *words, uint64_t bitOffset, const uint64_t *values, uint64_t n, uint64_t bits) {
+    if (!bits)
+        return;
+    const uint64_t mask = bits == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << bits) - 1;
+    for (uint64_t k = 0, bit = bitOffset; k < n; ++k, bit += bits) {
+        uint64_t v = values[k] & mask;
+        uint64_t shift = bit & 63;
+        words[bit >> 6] |= v << shift;
+        if (shift + bits > 64)
+            words[(bit >> 6) + 1] |= v >> (64 - shift);
+    }
+}
+
+#ifdef AXC_AVX2
+/**
+ * AVX2 unpacking of values of at most 57 bits, four at once with a gather of the eight bytes starting at the byte of
+ * the first bit of each. Returns the number of values unpacked.
+ */
+AXC_TARGET_AVX2 static uint64_t axc__unpackBitsAVX2__(const char *bytes, uint64_t bitOffset, uint64_t *values,
+                                                      uint64_t n, uint64_t bits, uint64_t mask) {
+    const __m256i vmask = _mm256_set1_epi64x((long long) mask);
+    const __m256i seven = _mm256_set1_epi64x(7);
+    const __m256i step = _mm256_set1_epi64x((long long) (4 * bits));
+    __m256i vbit = _mm256_add_epi64(_mm256_set1_epi64x((long long) bitOffset),
+                                    _mm256_set_epi64x((long long) (3 * bits), (long long) (2 * bits),
+                                                      (long long) bits, 0));
+    uint64_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256i v = _mm256_i64gather_epi64((const long long *) bytes, _mm256_srli_epi64(vbit, 3), 1);
+        v = _mm256_and_si256(_mm256_srlv_epi64(v, _mm256_and_si256(vbit, seven)), vmask);
+        _mm256_storeu_si256((__m256i *) (values + k), v);
+        vbit = _mm256_add_epi64(vbit, step);
+    }
+    return k;
+}
+#endif
+
+void axc__unpackBits__(const uint64_t *words, uint64_t bitOffset, uint64_t *values, uint64_t n, uint64_t bits) {
+    if (!bits) {
+        memset(values, 0, n * sizeof *values);
+        return;
+    }
+    const uint64_t mask = bits == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << bits) - 1;
+    const char *bytes = (const char *) words;
+    uint64_t k = 0;
+    if (bits <= 57) {
+        // every value lies within the eight bytes starting at the byte of its first bit
+#ifdef AXC_AVX2
+        if (axc__hasAVX2__())
+            k = axc__unpackBitsAVX2__(bytes, bitOffset, values, n, bits, mask);
+#endif
+        for (uint64_t bit = bitOffset + k * bits; k < n; ++k, bit += bits) {
+            uint64_t v;
+            memcpy(&v, bytes + (bit >> 3), 8);
+            values[k] = v >> (bit & 7) & mask;
+        }
+        return;
+    }
+    for (uint64_t bit = bitOffset; k < n; ++k, bit += bits) {
+        uint64_t shift = bit & 63;
+        uint64_t v = words[bit >> 6] >> shift;
+        if (shift + bits > 64)
+            v |= words[(bit >> 6) + 1] << (64 - shift);
+        values[k] = v & mask;
+    }
+}
+
+/**
+ * Moves the chunks of a mapped axchunk into a heap array of the given capacity and releases the mapping.
+ * The resize event handler is not called. Returns true iff OOM.
+ */
+static bool axc__unmap__(axchunk *c, uint64_t size) {
+    void *chunks = malloc_(size * c->width);
+    if (!chunks)
+        return true;
+    memcpy(chunks, c->chunks, MIN(c->len, size) * c->width);
+    axc__releaseMapping__(c);
+    c->chunks = chunks;
+    c->cap = size;
+    return false;
+}
+
+/**
+ * pwrite(2) that retries until everything has been written.
+ */
+static bool axc__writeAll__(int fd, const void *buf, size_t n, uint64_t offset) {
+    const char *p = buf;
+    while (n) {
+        ssize_t written = pwrite(fd, p, n, (off_t) offset);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return true;
+        }
+        p += written;
+        offset += (uint64_t) written;
+        n -= (size_t) written;
+    }
+    return false;
+}
+
+enum axcrecord {
+    AXC_RECORD_PUSH = 1,
+    AXC_RECORD_SET,
+    AXC_RECORD_WRITE,
+    AXC_RECORD_PATCH,
+    AXC_RECORD_DISCARD,
+    AXC_RECORD_SWAP,
+    AXC_RECORD_KILL,
+    AXC_RECORD_FILTER,
+    AXC_RECORD_POP,
+};
+
+/*
+ * Journal of an axchunk. Each record is an operation byte followed by its 64-bit arguments and its payload.
+ */
+struct axcjournal {
+    axchunk *buffer;
+    int fd;
+    uint64_t batch;
+    bool lost;
+};
+
+/**
+ * Writes the buffered records to the file descriptor of the journal, if there is one. Whatever could not be written
+ * stays buffered for the next attempt, so that the file never misses records in the middle. Returns true iff a write
+ * failed.
+ */
+static bool axc__flushJournal__(struct axcjournal *j) {
+    axchunk *b = j->buffer;
+    if (j->fd < 0 || !b->len)
+        return false;
+    uint64_t written = 0;
+    while (written < b->len) {
+        ssize_t n = write(j->fd, (char *) b->chunks + written, b->len - written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        written += (uint64_t) n;
+    }
+    memmove(b->chunks, (char *) b->chunks + written, b->len - written);
+    b->len -= written;
+    return b->len;
+}
+
+/**
+ * Appends a record to the journal. Room for the whole record is made first, so that the buffer never holds a partial
+ * record.
+ */
+static void axc__record__(axchunk *c, enum axcrecord op, const uint64_t *args, uint64_t nargs, const void *payload,
+                          uint64_t size) {
+    struct axcjournal *j = c->journal;
+    axchunk *b = j->buffer;
+    const uint64_t total = 1 + nargs * sizeof *args + size;
+    if (b->len + total > b->cap && axc_resize(b, MAX(b->cap << 1, b->len + total))) {
+        j->lost = true;
+        return;
+    }
+    char *p = axc__index__(b, b->len);
+    *p++ = (char) op;
+    if (nargs)
+        memcpy(p, args, nargs * sizeof *args);
+    if (size)
+        memcpy(p + nargs * sizeof *args, payload, size);
+    b->len += total;
+    if (j->fd >= 0 && b->len >= j->batch)
+        axc__flushJournal__(j);
+}
+
+void axc__journalPush__(axchunk *c) {
+    axc__record__(c, AXC_RECORD_PUSH, NULL, 0, axc__index__(c, c->len - 1), c->width);
+}
+
+void axc__journalSet__(axchunk *c, uint64_t i) {
+    axc__record__(c, AXC_RECORD_SET, &i, 1, axc__index__(c, i), c->width);
+}
+
+void axc__journalDiscard__(axchunk *c, uint64_t n) {
+    axc__record__(c, AXC_RECORD_DISCARD, &n, 1, NULL, 0);
+}
+
+void axc__journalPop__(axchunk *c) {
+    axc__record__(c, AXC_RECORD_POP, NULL, 0, NULL, 0);
+}
+
+/**
+ * Journals chkcount chunks at index i. Patches overwrite chunks in place, while writes behave like axc_write.
+ */
+static void axc__journalRange__(axchunk *c, enum axcrecord op, uint64_t i, uint64_t chkcount) {
+    const uint64_t args[2] = {i, chkcount};
+    axc__record__(c, op, args, 2, axc__index__(c, i), chkcount * c->width);
+}
+
+/**
+ * Bitmap for a compaction to note the chunks it keeps, or NULL if the axchunk does not journal. A journal whose bitmap
+ * cannot be allocated has lost the record of the compaction.
+ */
+static uint64_t *axc__keptBitmap__(axchunk *c) {
+    if (!c->journal)
+        return NULL;
+    const uint64_t words = (c->len >> 6) + 1;
+    uint64_t *kept = malloc_(words * sizeof *kept);
+    if (!kept) {
+        c->journal->lost = true;
+        return NULL;
+    }
+    memset(kept, 0, words * sizeof *kept);
+    return kept;
+}
+
+/**
+ * Journals a compaction of len chunks from the bitmap of the chunks it kept, starting at the word of the first chunk
+ * it removed, and frees the bitmap.
+ */
+static void axc__journalKept__(axchunk *c, uint64_t *kept, uint64_t len, uint64_t firstRemoved) {
+    if (!kept)
+        return;
+    if (firstRemoved < len) {
+        const uint64_t args[2] = {len, firstRemoved & ~(uint64_t) 63};
+        axc__record__(c, AXC_RECORD_FILTER, args, 2, kept + (args[1] >> 6), ((len - args[1] + 63) >> 6) * 8);
+    }
+    free_(kept);
+}
+
 axchunk *axc_new(uint64_t width) {
     return axc_newSized(width, 7);
 }
@@ -49,47 +580,144 @@ axchunk *axc_newSized(uint64_t width, uint64_t size) {
     c->width = width;
     c->destroy = NULL;
     c->resizeEventHandler = NULL;
+    c->dead = NULL;
+    c->deadWords = 0;
+    c->deadLen = 0;
+    c->compactionThreshold = 0.25;
+    c->prefetchDistance = 0;
+    c->mapping = NULL;
+    c->dirty = NULL;
+    c->dirtyWords = 0;
+    c->dirtyShift = 0;
+    c->journal = NULL;
     return c;
 }
 
 void *axc_destroy(axchunk *c) {
+    if (c->journal)
+        axc_journalEnd(c);
+    // a file-backed axchunk keeps its chunks, so its length and contents are written back before any destructor runs
+    if (c->mapping && c->mapping->fd >= 0)
+        axc_sync(c);
     if (c->destroy) {
-        for (char *chunk = c->chunks; c->len; --c->len) {
+        char *chunk = c->chunks;
+        for (uint64_t i = 0; i < c->len; ++i, chunk += c->width)
             c->destroy(chunk);
-            chunk += c->width;
-        }
     }
     void *resizeEventArgs = c->resizeEventArgs;
-    free_(c->chunks);
+    free_(c->dead);
+    free_(c->dirty);
+    if (c->mapping) {
+        axc__releaseMapping__(c);
+    } else {
+        free_(c->chunks);
+    }
     free_(c);
     return resizeEventArgs;
 }
 
 void *axc_destroySoft(axchunk *c) {
+    if (c->mapping && axc__unmap__(c, c->cap))
+        return NULL;
+    if (c->journal)
+        axc_journalEnd(c);
     void *chunks = c->chunks;
+    free_(c->dead);
+    free_(c->dirty);
     free_(c);
     return chunks;
 }
 
+/**
+ * Grows the dirty bitmap to cover the blocks of size chunks. Returns true iff OOM.
+ */
+static bool axc__growDirty__(axchunk *c, uint64_t size) {
+    const uint64_t words = (((size - 1) >> c->dirtyShift) >> 6) + 1;
+    if (words <= c->dirtyWords)
+        return false;
+    uint64_t *dirty = realloc_(c->dirty, words * sizeof *dirty);
+    if (!dirty)
+        return true;
+    memset(dirty + c->dirtyWords, 0, (words - c->dirtyWords) * sizeof *dirty);
+    c->dirty = dirty;
+    c->dirtyWords = words;
+    return false;
+}
+
 bool axc_resize(axchunk *c, uint64_t size) {
     size += !size;
     if (size == c->cap)
         return false;
-    intptr_t oldChunks = (intptr_t) c->chunks;
-    void *chunks = realloc_(c->chunks, size * c->width);
-    if (!chunks)
+    if (c->dirty && axc__growDirty__(c, size))
         return true;
-    ptrdiff_t offset = (intptr_t) chunks - oldChunks;
-    c->chunks = chunks;
-    c->cap = size;
+    intptr_t oldChunks = (intptr_t) c->chunks;
+    if (c->mapping && c->mapping->fd >= 0) {
+        if (axc__remap__(c, size))
+            return true;
+    } else if (c->mapping) {
+        if (axc__unmap__(c, size))
+            return true;
+    } else {
+        void *chunks = realloc_(c->chunks, size * c->width);
+        if (!chunks)
+            return true;
+        c->chunks = chunks;
+        c->cap = size;
+    }
+    ptrdiff_t offset = (intptr_t) c->chunks - oldChunks;
     if (c->resizeEventHandler)
         c->resizeEventHandler(c, offset, c->resizeEventArgs);
     return false;
 }
 
+bool axc_trackDirty(axchunk *c, uint64_t blockLen) {
+    if (!blockLen) {
+        free_(c->dirty);
+        c->dirty = NULL;
+        c->dirtyWords = 0;
+        return false;
+    }
+    uint64_t shift = 0;
+    while (shift < 63 && (uint64_t) 1 << shift < blockLen)
+        ++shift;
+    const uint64_t words = (((c->cap - 1) >> shift) >> 6) + 1;
+    uint64_t *dirty = malloc_(words * sizeof *dirty);
+    if (!dirty)
+        return true;
+    memset(dirty, 0, words * sizeof *dirty);
+    free_(c->dirty);
+    c->dirty = dirty;
+    c->dirtyWords = words;
+    c->dirtyShift = shift;
+    return false;
+}
+
+/**
+ * Grows the dead bitmap to cover the i-th chunk and at least the capacity. Returns true iff OOM.
+ */
+static bool axc__growDead__(axchunk *c, uint64_t i) {
+    if (i >> 6 < c->deadWords)
+        return false;
+    uint64_t words = (MAX(c->cap, i + 1) + 63) >> 6;
+    uint64_t *dead = realloc_(c->dead, words * sizeof *dead);
+    if (!dead)
+        return true;
+    memset(dead + c->deadWords, 0, (words - c->deadWords) * sizeof *dead);
+    c->dead = dead;
+    c->deadWords = words;
+    return false;
+}
+
 axchunk *axc_swap(axchunk *c, uint64_t i1, uint64_t i2) {
     if (i1 == i2 || i1 >= c->len || i2 >= c->len)
         return c;
+    // the live chunk may lie beyond the dead bitmap, which must cover it before the dead mark can move there
+    const bool dead1 = c->deadLen && axc__isDead__(c, i1);
+    const bool dead2 = c->deadLen && axc__isDead__(c, i2);
+    if (dead1 != dead2 && axc__growDead__(c, dead1 ? i2 : i1))
+        return c;
+    axc__markDirty__(c, i1, i1 + 1);
+    axc__markDirty__(c, i2, i2 + 1);
     enum {BUFSIZE = 16};
     char buf[BUFSIZE];
     char *chunk1 = axc__index__(c, i1);
@@ -108,38 +736,194 @@ axchunk *axc_swap(axchunk *c, uint64_t i1, uint64_t i2) {
         axc__quick_memcpy__(chunk1, chunk2, k);
         axc__quick_memcpy__(chunk2, buf, k);
     }
+    if (dead1 != dead2) {
+        const uint64_t live = dead1 ? i2 : i1;
+        axc__revive__(c, dead1 ? i1 : i2);
+        c->dead[live >> 6] |= (uint64_t) 1 << (live & 63);
+        ++c->deadLen;
+    }
+    if (c->journal) {
+        const uint64_t args[2] = {i1, i2};
+        axc__record__(c, AXC_RECORD_SWAP, args, 2, NULL, 0);
+    }
     return c;
 }
 
-axchunk *axc_foreach(axchunk *c, bool (*f)(void *, void *), void *arg) {
-    char *chunk = c->chunks;
-    for (uint64_t i = 0; i < c->len; ++i) {
-        if (!f(chunk, arg))
-            return c;
-        chunk += c->width;
+/**
+ * Prefetches every cache line of a chunk, up to four of them.
+ */
+static inline void axc__prefetch__(const char *chunk, uint64_t width, int rw) {
+    if (rw) {
+        __builtin_prefetch(chunk, 1);
+        for (uint64_t k = 64; k < width && k < 256; k += 64)
+            __builtin_prefetch(chunk + k, 1);
+    } else {
+        __builtin_prefetch(chunk, 0);
+        for (uint64_t k = 64; k < width && k < 256; k += 64)
+            __builtin_prefetch(chunk + k, 0);
     }
-    return c;
 }
 
-axchunk *axc_filter(axchunk *c, bool (*f)(const void *, void *), void *arg) {
+/**
+ * Clears the dead marks of all chunks in [from, to).
+ */
+static void axc__reviveRange__(axchunk *c, uint64_t from, uint64_t to) {
+    to = MIN(to, c->deadWords << 6);
+    for (uint64_t i = from; i < to; ++i)
+        axc__revive__(c, i);
+}
+
+/**
+ * Compaction shared by axc_filter and axc_compact. Keeps every chunk that is alive and, if f is given, satisfies f.
+ */
+static axchunk *axc__compact__(axchunk *c, bool (*f)(const void *, void *), void *arg) {
     const bool shouldDestroy = c->destroy;
+    const bool hasDead = c->deadLen;
+    const uint64_t ahead = c->prefetchDistance * c->width;
     char *chunk = c->chunks;
     char *filterChunk = c->chunks;
+    const uint64_t len = c->len;
+    uint64_t firstRemoved = len;
+    uint64_t *kept = axc__keptBitmap__(c);
     for (uint64_t i = 0; i < c->len; ++i) {
-        if (f(chunk, arg)) {
+        if (ahead && i + c->prefetchDistance < c->len)
+            axc__prefetch__(chunk + ahead, c->width, 0);
+        if (!(hasDead && axc__isDead__(c, i)) && (!f || f(chunk, arg))) {
             if (chunk != filterChunk)
                 axc__quick_memcpy__(filterChunk, chunk, c->width);
             filterChunk += c->width;
-        } else if (shouldDestroy) {
-            c->destroy(chunk);
+            if (kept)
+                kept[i >> 6] |= (uint64_t) 1 << (i & 63);
+        } else {
+            firstRemoved = MIN(firstRemoved, i);
+            if (shouldDestroy)
+                c->destroy(chunk);
         }
         chunk += c->width;
     }
     c->len -= (chunk - filterChunk) / c->width;
+    axc__markDirty__(c, firstRemoved, len);
+    axc__journalKept__(c, kept, len, firstRemoved);
+    if (hasDead) {
+        memset(c->dead, 0, c->deadWords * sizeof *c->dead);
+        c->deadLen = 0;
+    }
+    return c;
+}
+
+bool axc_kill(axchunk *c, uint64_t i) {
+    if (i >= c->len)
+        return true;
+    if (axc__growDead__(c, i))
+        return true;
+    uint64_t bit = (uint64_t) 1 << (i & 63);
+    if (c->dead[i >> 6] & bit)
+        return false;
+    c->dead[i >> 6] |= bit;
+    if (c->journal)
+        axc__record__(c, AXC_RECORD_KILL, &i, 1, NULL, 0);
+    if ((double) ++c->deadLen > (double) c->len * c->compactionThreshold)
+        axc__compact__(c, NULL, NULL);
+    return false;
+}
+
+axchunk *axc_compact(axchunk *c) {
+    return c->deadLen ? axc__compact__(c, NULL, NULL) : c;
+}
+
+axchunk *axc_foreach(axchunk *c, bool (*f)(void *, void *), void *arg) {
+    if (c->deadLen) {
+        // scan the bitmap a word at a time and visit only the live chunks of each word
+        for (uint64_t w = 0; w << 6 < c->len; ++w) {
+            uint64_t live = w < c->deadWords ? ~c->dead[w] : ~(uint64_t) 0;
+            if (c->len - (w << 6) < 64)
+                live &= ((uint64_t) 1 << (c->len - (w << 6))) - 1;
+            while (live) {
+                uint64_t i = (w << 6) | (uint64_t) __builtin_ctzll(live);
+                if (c->prefetchDistance && i + c->prefetchDistance < c->len)
+                    axc__prefetch__(axc__index__(c, i + c->prefetchDistance), c->width, 0);
+                if (!f(axc__index__(c, i), arg))
+                    return c;
+                live &= live - 1;
+            }
+        }
+        return c;
+    }
+    char *chunk = c->chunks;
+    if (c->prefetchDistance) {
+        for (uint64_t i = 0; i < c->len; ++i) {
+            if (i + c->prefetchDistance < c->len)
+                axc__prefetch__(chunk + c->prefetchDistance * c->width, c->width, 0);
+            if (!f(chunk, arg))
+                return c;
+            chunk += c->width;
+        }
+        return c;
+    }
+    for (uint64_t i = 0; i < c->len; ++i) {
+        if (!f(chunk, arg))
+            return c;
+        chunk += c->width;
+    }
+    return c;
+}
+
+axchunk *axc_filter(axchunk *c, bool (*f)(const void *, void *), void *arg) {
+    return axc__compact__(c, f, arg);
+}
+
+/**
+ * Unique loop specialised for chunks of a compile-time constant width.
+ */
+#define AXC_UNIQUE_LOOP(width_) do { \
+    for (uint64_t i = 0; i < c->len; ++i, chunk += (width_)) { \
+        if (!(hasDead && axc__isDead__(c, i)) \
+            && (uniqueChunk == c->chunks || memcmp(uniqueChunk - (width_), chunk, (width_)))) { \
+            if (chunk != uniqueChunk) \
+                memcpy(uniqueChunk, chunk, (width_)); \
+            uniqueChunk += (width_); \
+            if (kept) \
+                kept[i >> 6] |= (uint64_t) 1 << (i & 63); \
+        } else { \
+            firstRemoved = MIN(firstRemoved, i); \
+            if (c->destroy) \
+                c->destroy(chunk); \
+        } \
+    } \
+} while (0)
+
+axchunk *axc_unique(axchunk *c) {
+    const bool hasDead = c->deadLen;
+    const uint64_t len = c->len;
+    uint64_t firstRemoved = len;
+    uint64_t *kept = axc__keptBitmap__(c);
+    char *chunk = c->chunks;
+    char *uniqueChunk = c->chunks;
+    switch (c->width) {
+    case 1: AXC_UNIQUE_LOOP(1); break;
+    case 2: AXC_UNIQUE_LOOP(2); break;
+    case 4: AXC_UNIQUE_LOOP(4); break;
+    case 8: AXC_UNIQUE_LOOP(8); break;
+    case 16: AXC_UNIQUE_LOOP(16); break;
+    default: AXC_UNIQUE_LOOP(c->width); break;
+    }
+    c->len = (uint64_t) (uniqueChunk - (char *) c->chunks) / c->width;
+    axc__markDirty__(c, firstRemoved, len);
+    axc__journalKept__(c, kept, len, firstRemoved);
+    if (hasDead) {
+        memset(c->dead, 0, c->deadWords * sizeof *c->dead);
+        c->deadLen = 0;
+    }
     return c;
 }
 
 axchunk *axc_clear(axchunk *c) {
+    if (c->journal && c->len)
+        axc__journalDiscard__(c, c->len);
+    if (c->deadLen) {
+        memset(c->dead, 0, c->deadWords * sizeof *c->dead);
+        c->deadLen = 0;
+    }
     if (c->destroy) {
         for (char *chunk = c->chunks; c->len; --c->len) {
             c->destroy(chunk);
@@ -153,6 +937,10 @@ axchunk *axc_clear(axchunk *c) {
 
 axchunk *axc_discard(axchunk *c, uint64_t n) {
     n = c->len - MIN(c->len, n);
+    if (c->journal && n < c->len)
+        axc__journalDiscard__(c, c->len - n);
+    if (c->deadLen)
+        axc__reviveRange__(c, n, c->len);
     if (c->destroy) {
         for (char *chunk = axc__index__(c, c->len); c->len > n; --c->len)
             c->destroy(chunk -= c->width);
@@ -167,19 +955,35 @@ void *axc_internalCopy(axchunk *c) {
     void *copy = malloc_(size);
     if (!copy)
         return NULL;
-    return memcpy(copy, c->chunks, size);
+    return axc__bulkcopy__(copy, c->chunks, size);
 }
 
 axchunk *axc_copy(axchunk *c) {
     axchunk *copy = axc_newSized(c->width, c->cap);
     if (!copy)
         return NULL;
-    memcpy(copy->chunks, c->chunks, c->width * c->len);
+    axc__bulkcopy__(copy->chunks, c->chunks, c->width * c->len);
     copy->len = c->len;
+    copy->compactionThreshold = c->compactionThreshold;
+    copy->prefetchDistance = c->prefetchDistance;
+    if (c->deadLen) {
+        copy->dead = malloc_(c->deadWords * sizeof *c->dead);
+        if (!copy->dead) {
+            axc_destroy(copy);
+            return NULL;
+        }
+        memcpy(copy->dead, c->dead, c->deadWords * sizeof *c->dead);
+        copy->deadWords = c->deadWords;
+        copy->deadLen = c->deadLen;
+    }
     return copy;
 }
 
-bool axc_write(axchunk *c, uint64_t i, void *chunks, uint64_t chkcount) {
+/**
+ * Makes room for writing chkcount chunks at index i: grows the axchunk if necessary and calls the destructor on the
+ * chunks that are about to be overwritten. Returns true iff OOM.
+ */
+static bool axc__prepareWrite__(axchunk *c, uint64_t i, uint64_t chkcount) {
     if (i + chkcount > c->cap) {
         uint64_t size1 = (c->cap << 1) | 1;
         uint64_t size2 = i + chkcount;
@@ -193,17 +997,2473 @@ bool axc_write(axchunk *c, uint64_t i, void *chunks, uint64_t chkcount) {
             chunk += c->width;
         }
     }
-    axc__quick_memmove__(axc__index__(c, i), chunks, chkcount * c->width);
+    return false;
+}
+
+/**
+ * Updates dead marks and length after chkcount chunks have been written at index i.
+ */
+static void axc__finishWrite__(axchunk *c, uint64_t i, uint64_t chkcount) {
+    axc__markDirty__(c, i, i + chkcount);
+    if (c->deadLen)
+        axc__reviveRange__(c, i, MIN(i + chkcount, c->len));
     c->len = MAX(i + chkcount, c->len);
+    if (c->journal)
+        axc__journalRange__(c, AXC_RECORD_WRITE, i, chkcount);
+}
+
+bool axc_takeDirty(axchunk *c, axchunk *outBlocks) {
+    if (!c->dirty || outBlocks->width != sizeof(uint64_t))
+        return true;
+    uint64_t count = 0;
+    for (uint64_t w = 0; w < c->dirtyWords; ++w)
+        count += (uint64_t) __builtin_popcountll(c->dirty[w]);
+    if (outBlocks->len + count > outBlocks->cap && axc_resize(outBlocks, outBlocks->len + count))
+        return true;
+    uint64_t *out = (uint64_t *) outBlocks->chunks + outBlocks->len;
+    for (uint64_t w = 0; w < c->dirtyWords; ++w) {
+        for (uint64_t bits = c->dirty[w]; bits; bits &= bits - 1)
+            *out++ = (w << 6) | (uint64_t) __builtin_ctzll(bits);
+        c->dirty[w] = 0;
+    }
+    axc__finishWrite__(outBlocks, outBlocks->len, count);
     return false;
 }
 
+bool axc_write(axchunk *c, uint64_t i, void *chunks, uint64_t chkcount) {
+    if (axc__prepareWrite__(c, i, chkcount))
+        return true;
+    axc__bulkmove__(axc__index__(c, i), chunks, chkcount * c->width);
+    axc__finishWrite__(c, i, chkcount);
+    return false;
+}
 
 uint64_t axc_read(axchunk *c, uint64_t i, void *chunks, uint64_t chkcount) {
     if (i >= c->len)
         return 0;
     if (i + chkcount > c->len)
         chkcount -= i + chkcount - c->len;
-    axc__quick_memmove__(chunks, axc__index__(c, i), chkcount * c->width);
+    axc__bulkmove__(chunks, axc__index__(c, i), chkcount * c->width);
+    return chkcount;
+}
+
+bool axc_journal(axchunk *c, int fd, uint64_t batch) {
+    if (c->journal)
+        axc_journalEnd(c);
+    batch = batch ? batch : AXC_JOURNAL_BATCH;
+    struct axcjournal *j = malloc_(sizeof *j);
+    if (j)
+        j->buffer = axc_newSized(1, fd >= 0 ? batch : AXC_JOURNAL_BATCH);
+    if (!j || !j->buffer) {
+        free_(j);
+        return true;
+    }
+    j->fd = fd;
+    j->batch = batch;
+    j->lost = false;
+    c->journal = j;
+    return false;
+}
+
+bool axc_journalFlush(axchunk *c) {
+    if (!c->journal)
+        return true;
+    const bool failed = axc__flushJournal__(c->journal);
+    return failed || c->journal->lost;
+}
+
+axchunk *axc_journalBuffer(axchunk *c) {
+    return c->journal ? c->journal->buffer : NULL;
+}
+
+bool axc_journalEnd(axchunk *c) {
+    if (!c->journal)
+        return false;
+    struct axcjournal *j = c->journal;
+    const bool lost = axc__flushJournal__(j) || j->lost;
+    c->journal = NULL;
+    axc_destroy(j->buffer);
+    free_(j);
+    return lost;
+}
+
+/**
+ * Replays a journaled compaction: keeps all chunks before from and those in [from, len) whose bit is set.
+ */
+static void axc__keep__(axchunk *c, uint64_t from, const char *bits) {
+    const uint64_t len = c->len;
+    char *chunk = axc__index__(c, from);
+    char *keptChunk = chunk;
+    for (uint64_t i = from; i < len; ++i, chunk += c->width) {
+        uint64_t word;
+        memcpy(&word, bits + ((i - from) >> 6) * sizeof word, sizeof word);
+        if (word >> (i & 63) & 1) {
+            if (chunk != keptChunk)
+                memcpy(keptChunk, chunk, c->width);
+            keptChunk += c->width;
+        } else if (c->destroy) {
+            c->destroy(chunk);
+        }
+    }
+    c->len = (uint64_t) (keptChunk - (char *) c->chunks) / c->width;
+    axc__markDirty__(c, from, len);
+    if (c->deadLen) {
+        memset(c->dead, 0, c->deadWords * sizeof *c->dead);
+        c->deadLen = 0;
+    }
+}
+
+/**
+ * Applies a single record with its arguments and payload. Returns true iff OOM or the record does not fit the axchunk.
+ */
+static bool axc__applyRecord__(axchunk *c, enum axcrecord op, const uint64_t *args, const char *payload) {
+    switch (op) {
+    case AXC_RECORD_PUSH:
+        return axc_push(c, (void *) payload);
+    case AXC_RECORD_SET:
+        return axc_set(c, args[0], (void *) payload);
+    case AXC_RECORD_WRITE:
+        return args[0] > c->len || axc_write(c, args[0], (void *) payload, args[1]);
+    case AXC_RECORD_PATCH:
+        if (args[0] > c->len || args[1] > c->len - args[0])
+            return true;
+        memcpy(axc__index__(c, args[0]), payload, args[1] * c->width);
+        axc__markDirty__(c, args[0], args[0] + args[1]);
+        return false;
+    case AXC_RECORD_DISCARD:
+        if (args[0] > c->len)
+            return true;
+        axc_discard(c, args[0]);
+        return false;
+    case AXC_RECORD_SWAP:
+        if (args[0] >= c->len || args[1] >= c->len)
+            return true;
+        axc_swap(c, args[0], args[1]);
+        return false;
+    case AXC_RECORD_KILL:
+        return axc_kill(c, args[0]);
+    case AXC_RECORD_FILTER:
+        if (args[0] != c->len)
+            return true;
+        axc__keep__(c, args[1], payload);
+        return false;
+    case AXC_RECORD_POP:
+        // the popped chunk was handed to the caller rather than destroyed
+        if (!c->len)
+            return true;
+        --c->len;
+        if (c->deadLen)
+            axc__revive__(c, c->len);
+        return false;
+    }
+    return true;
+}
+
+bool axc_replay(axchunk *c, const void *records, uint64_t size) {
+    // compactions are replayed from their own records, so killing must not trigger any
+    struct axcjournal *journal = c->journal;
+    const double threshold = c->compactionThreshold;
+    c->journal = NULL;
+    c->compactionThreshold = 1;
+    const char *p = records;
+    const char *end = p + size;
+    bool failed = false;
+    while (!failed && p < end) {
+        const enum axcrecord op = (enum axcrecord) (unsigned char) *p;
+        uint64_t nargs;
+        switch (op) {
+        case AXC_RECORD_PUSH: case AXC_RECORD_POP: nargs = 0; break;
+        case AXC_RECORD_SET: case AXC_RECORD_DISCARD: case AXC_RECORD_KILL: nargs = 1; break;
+        case AXC_RECORD_WRITE: case AXC_RECORD_PATCH: case AXC_RECORD_SWAP: case AXC_RECORD_FILTER: nargs = 2; break;
+        default: failed = true; continue;
+        }
+        uint64_t args[2] = {0, 0};
+        if ((uint64_t) (end - p - 1) < nargs * sizeof *args)
+            break;
+        memcpy(args, p + 1, nargs * sizeof *args);
+        const char *payload = p + 1 + nargs * sizeof *args;
+        const uint64_t avail = (uint64_t) (end - payload);
+
+        // a record running past the end is the torn tail of a journal and is dropped
+        uint64_t payloadSize = 0;
+        if (op == AXC_RECORD_PUSH || op == AXC_RECORD_SET) {
+            payloadSize = c->width;
+        } else if (op == AXC_RECORD_WRITE || op == AXC_RECORD_PATCH) {
+            if (args[1] > avail / c->width)
+                break;
+            payloadSize = args[1] * c->width;
+        } else if (op == AXC_RECORD_FILTER) {
+            if (args[1] > args[0]) {
+                failed = true;
+                continue;
+            }
+            payloadSize = ((args[0] - args[1] + 63) >> 6) * sizeof(uint64_t);
+        }
+        if (payloadSize > avail)
+            break;
+        failed = axc__applyRecord__(c, op, args, payload);
+        p = payload + payloadSize;
+    }
+    c->journal = journal;
+    c->compactionThreshold = threshold;
+    return failed;
+}
+
+bool axc_replayFd(axchunk *c, int fd) {
+    axchunk *records = axc_newSized(1, AXC_JOURNAL_BATCH);
+    if (!records)
+        return true;
+    bool failed = false;
+    while (!failed) {
+        if (records->len == records->cap && axc_resize(records, records->cap << 1)) {
+            failed = true;
+            break;
+        }
+        ssize_t n = read(fd, axc__index__(records, records->len), records->cap - records->len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            failed = n < 0;
+            break;
+        }
+        records->len += (uint64_t) n;
+    }
+    if (!failed)
+        failed = axc_replay(c, records->chunks, records->len);
+    axc_destroy(records);
+    return failed;
+}
+
+/**
+ * Prefetch distance for random accesses, which always prefetch.
+ */
+static inline uint64_t axc__prefetchDistance__(axchunk *c) {
+    return c->prefetchDistance ? c->prefetchDistance : AXC_PREFETCH_DISTANCE;
+}
+
+/**
+ * Gather loop specialised for chunks of a compile-time constant width.
+ */
+#define AXC_GATHER_LOOP(width_) do { \
+    for (uint64_t k = 0; k < n; ++k) { \
+        if (k + dist < n && indices[k + dist] < len) \
+            __builtin_prefetch(base + indices[k + dist] * (width_), 0); \
+        if (indices[k] < len) { \
+            memcpy(out + k * (width_), base + indices[k] * (width_), (width_)); \
+            ++copied; \
+        } \
+    } \
+} while (0)
+
+#ifdef AXC_AVX2
+/**
+ * AVX2 gather of 4- or 8-byte chunks. Four indices are gathered at once as long as all of them are in range, so
+ * the hardware can keep several cache misses in flight. Returns the number of indices handled.
+ */
+AXC_TARGET_AVX2 static uint64_t axc__gatherAVX2__(axchunk *src, const uint64_t *indices, uint64_t n, void *dst,
+                                                  uint64_t *copied) {
+    const uint64_t len = src->len;
+    const uint64_t dist = axc__prefetchDistance__(src);
+    uint64_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        if (indices[k] >= len || indices[k + 1] >= len || indices[k + 2] >= len || indices[k + 3] >= len)
+            break;
+        if (k + 4 + dist <= n) {
+            for (uint64_t p = 0; p < 4; ++p) {
+                if (indices[k + dist + p] < len)
+                    __builtin_prefetch(axc__index__(src, indices[k + dist + p]), 0);
+            }
+        }
+        __m256i vindex = _mm256_loadu_si256((const __m256i *) (indices + k));
+        if (src->width == 8) {
+            __m256i v = _mm256_i64gather_epi64((const long long *) src->chunks, vindex, 8);
+            _mm256_storeu_si256((__m256i *) ((uint64_t *) dst + k), v);
+        } else {
+            __m128i v = _mm256_i64gather_epi32((const int *) src->chunks, vindex, 4);
+            _mm_storeu_si128((__m128i *) ((uint32_t *) dst + k), v);
+        }
+    }
+    *copied += k;
+    return k;
+}
+#endif
+
+uint64_t axc_gather(axchunk *src, const uint64_t *indices, uint64_t n, void *dst) {
+    const uint64_t len = src->len;
+    const uint64_t dist = axc__prefetchDistance__(src);
+    const uint64_t width = src->width;
+    uint64_t copied = 0;
+#ifdef AXC_AVX2
+    if ((width == 4 || width == 8) && axc__hasAVX2__()) {
+        uint64_t done = axc__gatherAVX2__(src, indices, n, dst, &copied);
+        indices += done;
+        dst = (char *) dst + done * width;
+        n -= done;
+    }
+#endif
+    const char *base = src->chunks;
+    char *out = dst;
+    switch (width) {
+    case 1: AXC_GATHER_LOOP(1); break;
+    case 2: AXC_GATHER_LOOP(2); break;
+    case 4: AXC_GATHER_LOOP(4); break;
+    case 8: AXC_GATHER_LOOP(8); break;
+    case 16: AXC_GATHER_LOOP(16); break;
+    default:
+        for (uint64_t k = 0; k < n; ++k) {
+            if (k + dist < n && indices[k + dist] < len)
+                axc__prefetch__(base + indices[k + dist] * width, width, 0);
+            if (indices[k] < len) {
+                memcpy(out + k * width, base + indices[k] * width, width);
+                ++copied;
+            }
+        }
+    }
+    return copied;
+}
+
+/**
+ * Scatter loop specialised for chunks of a compile-time constant width.
+ */
+#define AXC_SCATTER_LOOP(width_) do { \
+    for (uint64_t k = 0; k < n; ++k) { \
+        if (k + dist < n && indices[k + dist] < len) \
+            __builtin_prefetch(base + indices[k + dist] * (width_), 1); \
+        if (indices[k] < len) { \
+            memcpy(base + indices[k] * (width_), in + k * (width_), (width_)); \
+            ++copied; \
+        } \
+    } \
+} while (0)
+
+uint64_t axc_scatter(axchunk *dst, const uint64_t *indices, uint64_t n, void *src) {
+    const uint64_t len = dst->len;
+    const uint64_t dist = axc__prefetchDistance__(dst);
+    const uint64_t width = dst->width;
+    uint64_t copied = 0;
+    char *base = dst->chunks;
+    const char *in = src;
+    if (dst->destroy) {
+        // each chunk is destroyed right before it is overwritten, as an index may occur more than once
+        for (uint64_t k = 0; k < n; ++k) {
+            if (k + dist < n && indices[k + dist] < len)
+                axc__prefetch__(base + indices[k + dist] * width, width, 1);
+            if (indices[k] < len) {
+                dst->destroy(base + indices[k] * width);
+                memcpy(base + indices[k] * width, in + k * width, width);
+                ++copied;
+            }
+        }
+    } else {
+        switch (width) {
+        case 1: AXC_SCATTER_LOOP(1); break;
+        case 2: AXC_SCATTER_LOOP(2); break;
+        case 4: AXC_SCATTER_LOOP(4); break;
+        case 8: AXC_SCATTER_LOOP(8); break;
+        case 16: AXC_SCATTER_LOOP(16); break;
+        default:
+            for (uint64_t k = 0; k < n; ++k) {
+                if (k + dist < n && indices[k + dist] < len)
+                    axc__prefetch__(base + indices[k + dist] * width, width, 1);
+                if (indices[k] < len) {
+                    memcpy(base + indices[k] * width, in + k * width, width);
+                    ++copied;
+                }
+            }
+        }
+    }
+    if (dst->deadLen || dst->dirty || dst->journal) {
+        for (uint64_t k = 0; k < n; ++k) {
+            if (indices[k] < len) {
+                axc__revive__(dst, indices[k]);
+                axc__markDirty__(dst, indices[k], indices[k] + 1);
+                if (dst->journal)
+                    axc__journalSet__(dst, indices[k]);
+            }
+        }
+    }
+    return copied;
+}
+
+void *axc_getMany(axchunk *c, const uint64_t *indices, uint64_t n, void *dest) {
+    const uint64_t batch = axc__prefetchDistance__(c);
+    char *out = dest;
+    for (uint64_t k = 0; k < n; k += batch) {
+        const uint64_t end = MIN(k + batch, n);
+        for (uint64_t j = k; j < end; ++j) {
+            if (indices[j] < c->len)
+                axc__prefetch__(axc__index__(c, indices[j]), c->width, 0);
+        }
+        for (uint64_t j = k; j < end; ++j) {
+            if (indices[j] < c->len)
+                axc__quick_memcpy__(out + j * c->width, axc__index__(c, indices[j]), c->width);
+        }
+    }
+    return dest;
+}
+
+#ifdef __SSE2__
+/**
+ * Splits a stream of vectors into the stream of its even bytes followed by the stream of its odd bytes.
+ * Every sub-stream of per vectors in v is split separately, and the result is written to t.
+ */
+static inline void axc__splitEvenOdd__(const __m128i *v, __m128i *t, uint64_t w, uint64_t per) {
+    const __m128i low = _mm_set1_epi16(0xff);
+    for (uint64_t s = 0; s < w; s += per) {
+        for (uint64_t j = 0; j < per / 2; ++j) {
+            __m128i a = v[s + 2 * j];
+            __m128i b = v[s + 2 * j + 1];
+            t[s + j] = _mm_packus_epi16(_mm_and_si128(a, low), _mm_and_si128(b, low));
+            t[s + per / 2 + j] = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+        }
+    }
+}
+
+/**
+ * Inverse of axc__splitEvenOdd__.
+ */
+static inline void axc__mergeEvenOdd__(const __m128i *v, __m128i *t, uint64_t w, uint64_t per) {
+    for (uint64_t s = 0; s < w; s += per) {
+        for (uint64_t j = 0; j < per / 2; ++j) {
+            __m128i e = v[s + j];
+            __m128i o = v[s + per / 2 + j];
+            t[s + 2 * j] = _mm_unpacklo_epi8(e, o);
+            t[s + 2 * j + 1] = _mm_unpackhi_epi8(e, o);
+        }
+    }
+}
+
+/**
+ * Reverses the lowest bits of k, where bits is the number of bits of w - 1.
+ */
+static inline uint64_t axc__bitReverse__(uint64_t k, uint64_t w) {
+    uint64_t r = 0;
+    for (uint64_t bit = 1; bit < w; bit <<= 1) {
+        r = (r << 1) | (k & 1);
+        k >>= 1;
+    }
+    return r;
+}
+
+/**
+ * Byte-shuffles 16 chunks of a power-of-two width up to 16 held in w vectors. Repeatedly splitting the byte stream
+ * into even and odd bytes leaves byte plane p in vector bitreverse(p).
+ */
+static void axc__shuffle16__(const char *src, char *dst, uint64_t n, uint64_t w) {
+    __m128i v[16], t[16];
+    for (uint64_t k = 0; k < w; ++k)
+        v[k] = _mm_loadu_si128((const __m128i *) (src + 16 * k));
+    for (uint64_t per = w; per > 1; per >>= 1) {
+        axc__splitEvenOdd__(v, t, w, per);
+        memcpy(v, t, w * sizeof *v);
+    }
+    for (uint64_t k = 0; k < w; ++k)
+        _mm_storeu_si128((__m128i *) (dst + axc__bitReverse__(k, w) * n), v[k]);
+}
+
+/**
+ * Inverse of axc__shuffle16__.
+ */
+static void axc__unshuffle16__(const char *src, char *dst, uint64_t n, uint64_t w) {
+    __m128i v[16], t[16];
+    for (uint64_t k = 0; k < w; ++k)
+        v[k] = _mm_loadu_si128((const __m128i *) (src + axc__bitReverse__(k, w) * n));
+    for (uint64_t per = 2; per <= w; per <<= 1) {
+        axc__mergeEvenOdd__(v, t, w, per);
+        memcpy(v, t, w * sizeof *v);
+    }
+    for (uint64_t k = 0; k < w; ++k)
+        _mm_storeu_si128((__m128i *) (dst + 16 * k), v[k]);
+}
+#endif
+
+/**
+ * Whether the SIMD kernels handle chunks of this width.
+ */
+static inline bool axc__shuffleSIMD__(uint64_t width) {
+#ifdef __SSE2__
+    return width == 2 || width == 4 || width == 8 || width == 16;
+#else
+    (void) width;
+    return false;
+#endif
+}
+
+void axc_shuffleBytes(const void *src, void *dst, uint64_t n, uint64_t width) {
+    const uint8_t *in = src;
+    uint8_t *out = dst;
+    uint64_t k = 0;
+#ifdef __SSE2__
+    if (axc__shuffleSIMD__(width)) {
+        for (; k + 16 <= n; k += 16)
+            axc__shuffle16__((const char *) in + k * width, (char *) out + k, n, width);
+    }
+#endif
+    for (uint64_t b = 0; b < width; ++b) {
+        uint8_t *plane = out + b * n;
+        for (uint64_t j = k; j < n; ++j)
+            plane[j] = in[j * width + b];
+    }
+}
+
+void axc_unshuffleBytes(const void *src, void *dst, uint64_t n, uint64_t width) {
+    const uint8_t *in = src;
+    uint8_t *out = dst;
+    uint64_t k = 0;
+#ifdef __SSE2__
+    if (axc__shuffleSIMD__(width)) {
+        for (; k + 16 <= n; k += 16)
+            axc__unshuffle16__((const char *) in + k, (char *) out + k * width, n, width);
+    }
+#endif
+    for (uint64_t b = 0; b < width; ++b) {
+        const uint8_t *plane = in + b * n;
+        for (uint64_t j = k; j < n; ++j)
+            out[j * width + b] = plane[j];
+    }
+}
+
+void *axc_shuffle(axchunk *c, void *dst) {
+    axc_shuffleBytes(c->chunks, dst, c->len, c->width);
+    return dst;
+}
+
+bool axc_unshuffle(axchunk *c, uint64_t i, const void *src, uint64_t chkcount) {
+    if (axc__prepareWrite__(c, i, chkcount))
+        return true;
+    axc_unshuffleBytes(src, axc__index__(c, i), chkcount, c->width);
+    axc__finishWrite__(c, i, chkcount);
+    return false;
+}
+
+uint64_t axcv_read(axcview v, uint64_t i, void *chunks, uint64_t chkcount) {
+    uint64_t len = axcv_len(v);
+    if (i >= len)
+        return 0;
+    chkcount = MIN(chkcount, len - i);
+    axchunk *c = v.base;
+    if (v.stride == 1) {
+        axc__bulkmove__(chunks, axc__index__(c, v.offset + i), chkcount * c->width);
+        return chkcount;
+    }
+    char *dst = chunks;
+    char *src = axc__index__(c, v.offset + i * v.stride);
+    const uint64_t step = v.stride * c->width;
+    for (uint64_t k = 0; k < chkcount; ++k) {
+        axc__quick_memcpy__(dst, src, c->width);
+        dst += c->width;
+        src += step;
+    }
     return chkcount;
 }
+
+axcview axcv_foreach(axcview v, bool (*f)(void *, void *), void *arg) {
+    axchunk *c = v.base;
+    for (uint64_t k = 0, i = v.offset; k < axcv_len(v); ++k, i += v.stride) {
+        if (c->deadLen && axc_isDead(c, i))
+            continue;
+        if (!f(axc__index__(c, i), arg))
+            return v;
+    }
+    return v;
+}
+
+axchunk *axcv_filter(axcview v, bool (*f)(const void *, void *), void *arg) {
+    axchunk *c = v.base;
+    const uint64_t len = axcv_len(v);
+    axchunk *filtered = axc_newSized(c->width, len);
+    if (!filtered)
+        return NULL;
+    char *dst = filtered->chunks;
+    for (uint64_t k = 0, i = v.offset; k < len; ++k, i += v.stride) {
+        void *chunk = axc__index__(c, i);
+        if (c->deadLen && axc_isDead(c, i))
+            continue;
+        if (f(chunk, arg)) {
+            axc__quick_memcpy__(dst, chunk, c->width);
+            dst += c->width;
+        }
+    }
+    filtered->len = (dst - (char *) filtered->chunks) / c->width;
+    return filtered;
+}
+
+bool axc_save(axchunk *c, int fd) {
+    static const char padding[AXC_FILE_ALIGNMENT];
+    axcheader header;
+    axc__header__(&header, c->width, c->len, c->chunks);
+    if (axc__writeAll__(fd, &header, sizeof header, 0)
+        || axc__writeAll__(fd, padding, AXC_FILE_ALIGNMENT - sizeof header, sizeof header))
+        return true;
+    for (uint64_t offset = AXC_FILE_ALIGNMENT; offset < header.alignment; offset += AXC_FILE_ALIGNMENT) {
+        if (axc__writeAll__(fd, padding, AXC_FILE_ALIGNMENT, offset))
+            return true;
+    }
+    return axc__writeAll__(fd, c->chunks, c->width * c->len, header.alignment);
+}
+
+bool axc_verify(axchunk *c) {
+    if (!c->mapping || c->mapping->fd >= 0)
+        return true;
+    const axcheader *header = c->mapping->base;
+    return header->flags & AXC_FILE_UNCHECKED || header->len != c->len
+        || header->checksum != axc__hash__(c->chunks, c->width * c->len, 0);
+}
+
+axchunk *axc_mmapLoad(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    axcheader header;
+    struct stat st;
+    if (fstat(fd, &st) || pread(fd, &header, sizeof header, 0) != sizeof header
+        || !axc__validHeader__(&header, (uint64_t) st.st_size)) {
+        close(fd);
+        return NULL;
+    }
+    if (!header.len) {
+        close(fd);
+        return axc_new(header.width);
+    }
+    axchunk *c = axc_newSized(header.width, 1);
+    struct axcmapping *mapping = malloc_(sizeof *mapping);
+    void *base = MAP_FAILED;
+    if (c && mapping)
+        base = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        free_(mapping);
+        if (c)
+            axc_destroy(c);
+        return NULL;
+    }
+    free_(c->chunks);
+    mapping->base = base;
+    mapping->size = (size_t) st.st_size;
+    mapping->alignment = header.alignment;
+    mapping->fd = -1;
+    c->mapping = mapping;
+    c->chunks = (char *) base + header.alignment;
+    c->len = header.len;
+    c->cap = header.len;
+    return c;
+}
+
+axchunk *axc_newFileBacked(const char *path, uint64_t width, uint64_t size) {
+    size += !size;
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return NULL;
+    axcheader header;
+    struct stat st;
+    if (fstat(fd, &st))
+        goto fail;
+    if (st.st_size) {
+        if (pread(fd, &header, sizeof header, 0) != sizeof header
+            || !axc__validHeader__(&header, (uint64_t) st.st_size)
+            || (width && header.width != width)) {
+            errno = EINVAL;
+            goto fail;
+        }
+    } else {
+        axc__header__(&header, width + !width, 0, NULL);
+        if (pwrite(fd, &header, sizeof header, 0) != sizeof header
+            || ftruncate(fd, (off_t) (header.alignment + size * header.width)) || fstat(fd, &st))
+            goto fail;
+    }
+    uint64_t cap = ((uint64_t) st.st_size - header.alignment) / header.width;
+    if (!cap) {
+        cap = 1;
+        if (ftruncate(fd, (off_t) (header.alignment + header.width)) || fstat(fd, &st))
+            goto fail;
+    }
+    axchunk *c = axc_newSized(header.width, 1);
+    struct axcmapping *mapping = malloc_(sizeof *mapping);
+    void *base = MAP_FAILED;
+    if (c && mapping)
+        base = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        free_(mapping);
+        if (c)
+            axc_destroy(c);
+        goto fail;
+    }
+    free_(c->chunks);
+    mapping->base = base;
+    mapping->size = (size_t) st.st_size;
+    mapping->alignment = header.alignment;
+    mapping->fd = fd;
+    c->mapping = mapping;
+    c->chunks = (char *) base + header.alignment;
+    c->len = header.len;
+    c->cap = cap;
+    if (!(header.flags & AXC_FILE_UNCHECKED)) {
+        // the file is modified in place from now on, so its chunk checksum can no longer be maintained
+        axcheader *mapped = base;
+        mapped->flags |= AXC_FILE_UNCHECKED;
+        mapped->checksum = 0;
+        axc__stampHeader__(c);
+    }
+    return c;
+
+fail:
+    close(fd);
+    return NULL;
+}
+
+/**
+ * Writes back the pages of the occupied chunks in [i, i + n) of a file-backed axchunk. Returns true iff an I/O error
+ * occurred.
+ */
+static bool axc__syncChunks__(axchunk *c, uint64_t i, uint64_t n) {
+    if (i >= c->len || !n)
+        return false;
+    n = MIN(n, c->len - i);
+    const uintptr_t pageMask = (uintptr_t) sysconf(_SC_PAGESIZE) - 1;
+    uintptr_t from = (uintptr_t) axc__index__(c, i) & ~pageMask;
+    uintptr_t to = (uintptr_t) axc__index__(c, i + n);
+    return msync((void *) from, to - from, MS_SYNC);
+}
+
+bool axc_syncRange(axchunk *c, uint64_t i, uint64_t n) {
+    if (!c->mapping || c->mapping->fd < 0)
+        return false;
+    axc__stampHeader__(c);
+    if (msync(c->mapping->base, sizeof(axcheader), MS_SYNC))
+        return true;
+    return axc__syncChunks__(c, i, n);
+}
+
+bool axc_sync(axchunk *c) {
+    return axc_syncRange(c, 0, c->len);
+}
+
+bool axc_syncDirty(axchunk *c) {
+    if (!c->dirty || !c->mapping || c->mapping->fd < 0)
+        return axc_sync(c);
+    if (axc_syncRange(c, 0, 0))
+        return true;
+    // write back every run of dirty blocks at once, and clear the marks of a run only once it has been written
+    const uint64_t blocks = c->dirtyWords << 6;
+    for (uint64_t b = 0; b < blocks;) {
+        if (!(c->dirty[b >> 6] >> (b & 63))) {
+            b = (b | 63) + 1;
+            continue;
+        }
+        if (!(c->dirty[b >> 6] >> (b & 63) & 1)) {
+            ++b;
+            continue;
+        }
+        uint64_t end = b;
+        while (end < blocks && c->dirty[end >> 6] >> (end & 63) & 1)
+            ++end;
+        if (axc__syncChunks__(c, b << c->dirtyShift, (end - b) << c->dirtyShift))
+            return true;
+        for (; b < end; ++b)
+            c->dirty[b >> 6] &= ~((uint64_t) 1 << (b & 63));
+    }
+    return false;
+}
+
+#ifdef AXC_IO_URING
+/**
+ * A minimal io_uring set up with raw system calls, with the submission and completion rings mapped separately.
+ */
+typedef struct axcring {
+    int fd;
+    void *sq;
+    size_t sqSize;
+    void *cq;
+    size_t cqSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    atomic_uint *sqHead;
+    atomic_uint *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    atomic_uint *cqHead;
+    atomic_uint *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+} axcring;
+
+static void axc__closeRing__(axcring *ring) {
+    if (ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqesSize);
+    if (ring->cq != MAP_FAILED)
+        munmap(ring->cq, ring->cqSize);
+    if (ring->sq != MAP_FAILED)
+        munmap(ring->sq, ring->sqSize);
+    close(ring->fd);
+    free_(ring);
+}
+
+/**
+ * Sets up an io_uring for the given number of requests in flight.
+ * @return Ring or NULL iff io_uring is unavailable, e.g. because the kernel is too old or it is forbidden, or OOM.
+ */
+static axcring *axc__openRing__(unsigned entries) {
+    axcring *ring = malloc_(sizeof *ring);
+    if (!ring)
+        return NULL;
+    struct io_uring_params p;
+    memset(&p, 0, sizeof p);
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd < 0) {
+        free_(ring);
+        return NULL;
+    }
+    ring->sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    const int prot = PROT_READ | PROT_WRITE, flags = MAP_SHARED | MAP_POPULATE;
+    ring->sq = mmap(NULL, ring->sqSize, prot, flags, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq = mmap(NULL, ring->cqSize, prot, flags, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqesSize, prot, flags, ring->fd, IORING_OFF_SQES);
+    if (ring->sq == MAP_FAILED || ring->cq == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        axc__closeRing__(ring);
+        return NULL;
+    }
+    char *sq = ring->sq, *cq = ring->cq;
+    ring->sqHead = (atomic_uint *) (sq + p.sq_off.head);
+    ring->sqTail = (atomic_uint *) (sq + p.sq_off.tail);
+    ring->sqMask = (unsigned *) (sq + p.sq_off.ring_mask);
+    ring->sqArray = (unsigned *) (sq + p.sq_off.array);
+    ring->cqHead = (atomic_uint *) (cq + p.cq_off.head);
+    ring->cqTail = (atomic_uint *) (cq + p.cq_off.tail);
+    ring->cqMask = (unsigned *) (cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+    return ring;
+}
+#endif
+
+struct axcjob {
+    axchunk *c;
+    int fd;
+    int directFd;
+    atomic_bool direct;
+    bool save;
+    uint64_t alignment;
+    uint64_t size;
+    atomic_uint_fast64_t nextExtent;
+    atomic_uint running;
+    atomic_int error;
+    atomic_bool finished;
+    void (*done)(axcjob *, int, void *);
+    void *arg;
+#ifdef AXC_IO_URING
+    axcring *ring;
+    unsigned depth;
+#endif
+    pthread_mutex_t setup;
+    unsigned nthreads;
+    pthread_t threads[];
+};
+
+/**
+ * Chooses the file descriptor for transferring n bytes between mem and the file at offset, and lowers n to what is
+ * transferred through it. Whole aligned blocks go through the O_DIRECT descriptor as long as it works, everything else
+ * is buffered.
+ */
+static int axc__transferFd__(axcjob *job, const char *mem, uint64_t offset, uint64_t *n) {
+    if (job->directFd < 0 || !atomic_load_explicit(&job->direct, memory_order_relaxed)
+        || ((uintptr_t) mem | offset) % AXC_FILE_ALIGNMENT || *n < AXC_FILE_ALIGNMENT)
+        return job->fd;
+    *n &= ~(uint64_t) (AXC_FILE_ALIGNMENT - 1);
+    return job->directFd;
+}
+
+/**
+ * Handles the result of a transfer of n bytes through fd.
+ * @return Zero if the transfer is to be retried, the errno of a failure or -1 if it succeeded.
+ */
+static int axc__transferResult__(axcjob *job, int fd, int64_t done) {
+    if (done > 0)
+        return -1;
+    if (!done)
+        return EIO;
+    if (done == -EINTR || done == -EAGAIN)
+        return 0;
+    if (done == -EINVAL && fd == job->directFd) {
+        // the file system does not support O_DIRECT after all, so buffer everything from now on
+        atomic_store_explicit(&job->direct, false, memory_order_relaxed);
+        return 0;
+    }
+    return (int) -done;
+}
+
+/**
+ * Transfers one extent between memory and file.
+ */
+static int axc__transferExtent__(axcjob *job, char *mem, uint64_t offset, uint64_t n) {
+    while (n) {
+        uint64_t len = n;
+        int fd = axc__transferFd__(job, mem, offset, &len);
+        ssize_t done = job->save ? pwrite(fd, mem, len, (off_t) offset) : pread(fd, mem, len, (off_t) offset);
+        int error = axc__transferResult__(job, fd, done < 0 ? -errno : done);
+        if (error > 0)
+            return error;
+        if (error < 0) {
+            mem += done;
+            offset += (uint64_t) done;
+            n -= (uint64_t) done;
+        }
+    }
+    return 0;
+}
+
+static void axc__failJob__(axcjob *job, int error) {
+    int expected = 0;
+    atomic_compare_exchange_strong(&job->error, &expected, error);
+}
+
+/**
+ * Called by the last worker of a job to finish it.
+ */
+static void axc__finishJob__(axcjob *job) {
+    if (job->save && !atomic_load(&job->error) && fsync(job->fd))
+        axc__failJob__(job, errno);
+    void (*done)(axcjob *, int, void *) = job->done;
+    void *doneArg = job->arg;
+    int error = atomic_load(&job->error);
+    atomic_store(&job->finished, true);
+    if (done)
+        done(job, error, doneArg);
+}
+
+static void *axc__jobWorker__(void *arg) {
+    axcjob *job = arg;
+    // the job is only handed to the workers once all of them have been started
+    pthread_mutex_lock(&job->setup);
+    pthread_mutex_unlock(&job->setup);
+    const uint64_t extents = (job->size + AXC_EXTENT_SIZE - 1) / AXC_EXTENT_SIZE;
+    for (;;) {
+        uint64_t k = atomic_fetch_add(&job->nextExtent, 1);
+        if (k >= extents || atomic_load(&job->error))
+            break;
+        uint64_t offset = k * AXC_EXTENT_SIZE;
+        int error = axc__transferExtent__(job, (char *) job->c->chunks + offset, job->alignment + offset,
+                                          MIN((uint64_t) AXC_EXTENT_SIZE, job->size - offset));
+        if (error)
+            axc__failJob__(job, error);
+    }
+    if (atomic_fetch_sub(&job->running, 1) == 1)
+        axc__finishJob__(job);
+    return NULL;
+}
+
+#ifdef AXC_IO_URING
+/**
+ * The rest of an extent transferred by an io_uring request.
+ */
+typedef struct axcrequest {
+    char *mem;
+    uint64_t offset;
+    uint64_t n;
+    int fd;
+    bool inFlight;
+    struct iovec iov;
+} axcrequest;
+
+/**
+ * The single worker of an io_uring job. It keeps up to depth extents in flight and resubmits the rest of any short
+ * transfer.
+ */
+static void *axc__ringWorker__(void *arg) {
+    axcjob *job = arg;
+    pthread_mutex_lock(&job->setup);
+    pthread_mutex_unlock(&job->setup);
+    axcring *ring = job->ring;
+    axcrequest *requests = malloc_(job->depth * sizeof *requests);
+    if (!requests)
+        axc__failJob__(job, ENOMEM);
+    for (unsigned k = 0; requests && k < job->depth; ++k) {
+        requests[k].n = 0;
+        requests[k].inFlight = false;
+    }
+    unsigned inFlight = 0, unsubmitted = 0;
+    for (uint64_t next = 0; requests;) {
+        unsigned tail = atomic_load_explicit(ring->sqTail, memory_order_relaxed);
+        for (unsigned k = 0; k < job->depth; ++k) {
+            axcrequest *request = &requests[k];
+            if (request->inFlight)
+                continue;
+            // after a failure, the rest of the job is dropped
+            if (atomic_load(&job->error))
+                request->n = 0;
+            if (!request->n) {
+                if (next >= job->size || atomic_load(&job->error))
+                    continue;
+                request->mem = (char *) job->c->chunks + next;
+                request->offset = job->alignment + next;
+                request->n = MIN((uint64_t) AXC_EXTENT_SIZE, job->size - next);
+                next += request->n;
+            }
+            uint64_t len = request->n;
+            request->fd = axc__transferFd__(job, request->mem, request->offset, &len);
+            request->iov.iov_base = request->mem;
+            request->iov.iov_len = len;
+            const unsigned index = tail & *ring->sqMask;
+            struct io_uring_sqe *sqe = &ring->sqes[index];
+            memset(sqe, 0, sizeof *sqe);
+            sqe->opcode = job->save ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe->fd = request->fd;
+            sqe->off = request->offset;
+            sqe->addr = (uintptr_t) &request->iov;
+            sqe->len = 1;
+            sqe->user_data = k;
+            ring->sqArray[index] = index;
+            request->inFlight = true;
+            ++tail;
+            ++inFlight;
+            ++unsubmitted;
+        }
+        atomic_store_explicit(ring->sqTail, tail, memory_order_release);
+        if (!inFlight)
+            break;
+        long submitted = syscall(__NR_io_uring_enter, ring->fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            // this only happens for a broken ring, which cannot be waited upon any more
+            axc__failJob__(job, errno);
+            break;
+        }
+        if (submitted > 0)
+            unsubmitted -= (unsigned) submitted;
+        unsigned head = atomic_load_explicit(ring->cqHead, memory_order_relaxed);
+        for (const unsigned end = atomic_load_explicit(ring->cqTail, memory_order_acquire); head != end; ++head) {
+            const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+            axcrequest *request = &requests[cqe->user_data];
+            request->inFlight = false;
+            --inFlight;
+            int error = axc__transferResult__(job, request->fd, cqe->res);
+            if (error > 0) {
+                axc__failJob__(job, error);
+            } else if (error < 0) {
+                request->mem += cqe->res;
+                request->offset += (uint64_t) cqe->res;
+                request->n -= (uint64_t) cqe->res;
+            }
+        }
+        atomic_store_explicit(ring->cqHead, head, memory_order_release);
+    }
+    free_(requests);
+    if (atomic_fetch_sub(&job->running, 1) == 1)
+        axc__finishJob__(job);
+    return NULL;
+}
+#endif
+
+/**
+ * Opens another descriptor of a file for O_DIRECT transfers.
+ * @return Descriptor or -1 iff O_DIRECT is not supported.
+ */
+static int axc__openDirect__(const char *path, int flags) {
+#ifdef O_DIRECT
+    return open(path, flags | O_DIRECT);
+#else
+    (void) path;
+    (void) flags;
+    return -1;
+#endif
+}
+
+/**
+ * Allocates memory aligned for O_DIRECT transfers. This needs the default memory functions, with any others it just
+ * allocates, and O_DIRECT is only used if the memory happens to be aligned.
+ */
+static void *axc__mallocAligned__(size_t size) {
+    if (malloc_ != malloc || realloc_ != realloc || free_ != free)
+        return malloc_(size);
+    void *p;
+    return posix_memalign(&p, AXC_FILE_ALIGNMENT, size) ? NULL : p;
+}
+
+static void axc__closeJobFiles__(axcjob *job) {
+    close(job->fd);
+    if (job->directFd >= 0)
+        close(job->directFd);
+#ifdef AXC_IO_URING
+    if (job->ring)
+        axc__closeRing__(job->ring);
+#endif
+}
+
+/**
+ * Creates a job for an open file and starts its workers: a single one driving an io_uring if one can be set up, and
+ * otherwise a pool of threads. On failure, closes the file descriptors and destroys the axchunk of a load job.
+ */
+static axcjob *axc__startJob__(axchunk *c, int fd, int directFd, bool save, uint64_t alignment, unsigned threads,
+                               void (*done)(axcjob *, int, void *), void *arg) {
+    threads = threads ? threads : AXC_JOB_THREADS;
+    const unsigned depth = threads;
+#ifdef AXC_IO_URING
+    axcring *ring = ioUring_ ? axc__openRing__(depth) : NULL;
+    if (ring)
+        threads = 1;
+#endif
+    axcjob *job = malloc_(sizeof *job + threads * sizeof *job->threads);
+    if (!job || pthread_mutex_init(&job->setup, NULL)) {
+        free_(job);
+        close(fd);
+        if (directFd >= 0)
+            close(directFd);
+#ifdef AXC_IO_URING
+        if (ring)
+            axc__closeRing__(ring);
+#endif
+        if (!save)
+            axc_destroy(c);
+        return NULL;
+    }
+    job->c = c;
+    job->fd = fd;
+    job->directFd = directFd;
+    atomic_init(&job->direct, true);
+    job->save = save;
+    job->alignment = alignment;
+    job->size = c->len * c->width;
+    atomic_init(&job->nextExtent, 0);
+    atomic_init(&job->running, threads);
+    atomic_init(&job->error, 0);
+    atomic_init(&job->finished, false);
+    job->done = done;
+    job->arg = arg;
+    void *(*worker)(void *) = axc__jobWorker__;
+#ifdef AXC_IO_URING
+    job->ring = ring;
+    job->depth = depth;
+    if (ring)
+        worker = axc__ringWorker__;
+#else
+    (void) depth;
+#endif
+    job->nthreads = 0;
+    pthread_mutex_lock(&job->setup);
+    for (; job->nthreads < threads; ++job->nthreads) {
+        if (pthread_create(&job->threads[job->nthreads], NULL, worker, job))
+            break;
+    }
+    if (job->nthreads < threads) {
+        // the started workers are still held back, so they run straight into the error and finish without calling done
+        atomic_store(&job->error, EAGAIN);
+        atomic_fetch_sub(&job->running, threads - job->nthreads);
+        job->done = NULL;
+        if (!job->nthreads)
+            atomic_store(&job->finished, true);
+        pthread_mutex_unlock(&job->setup);
+        axc_wait(job, NULL);
+        return NULL;
+    }
+    pthread_mutex_unlock(&job->setup);
+    return job;
+}
+
+axcjob *axc_saveAsync(axchunk *c, const char *path, unsigned threads,
+                      void (*done)(axcjob *, int, void *), void *arg) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return NULL;
+    axcheader header;
+    axc__header__(&header, c->width, c->len, NULL);
+    if (pwrite(fd, &header, sizeof header, 0) != sizeof header
+        || ftruncate(fd, (off_t) (header.alignment + c->len * c->width))) {
+        close(fd);
+        return NULL;
+    }
+    return axc__startJob__(c, fd, axc__openDirect__(path, O_WRONLY), true, header.alignment, threads, done, arg);
+}
+
+axcjob *axc_loadAsync(const char *path, unsigned threads, void (*done)(axcjob *, int, void *), void *arg) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    axcheader header;
+    struct stat st;
+    axchunk *c = NULL;
+    if (fstat(fd, &st) || pread(fd, &header, sizeof header, 0) != sizeof header
+        || !axc__validHeader__(&header, (uint64_t) st.st_size)
+        || !(c = axc_newSized(header.width, 1))) {
+        close(fd);
+        return NULL;
+    }
+    // the chunks are read straight into page-aligned memory where the file system supports O_DIRECT
+    void *chunks = axc__mallocAligned__(header.width * MAX(header.len, 1));
+    if (!chunks) {
+        axc_destroy(c);
+        close(fd);
+        return NULL;
+    }
+    free_(c->chunks);
+    c->chunks = chunks;
+    c->cap = MAX(header.len, 1);
+    c->len = header.len;
+    return axc__startJob__(c, fd, axc__openDirect__(path, O_RDONLY), false, header.alignment, threads, done, arg);
+}
+
+bool axc_poll(axcjob *job) {
+    return atomic_load(&job->finished);
+}
+
+int axc_wait(axcjob *job, axchunk **loaded) {
+    for (unsigned k = 0; k < job->nthreads; ++k)
+        pthread_join(job->threads[k], NULL);
+    int error = atomic_load(&job->error);
+    axc__closeJobFiles__(job);
+    pthread_mutex_destroy(&job->setup);
+    if (!job->save) {
+        if (error) {
+            axc_destroy(job->c);
+            job->c = NULL;
+        }
+        if (loaded)
+            *loaded = job->c;
+        else if (job->c)
+            axc_destroy(job->c);
+    }
+    free_(job);
+    return error;
+}
+
+/**
+ * Number of parts to split n chunks of some width into for parallel execution. Every part covers at least
+ * AXC_PARALLEL_BYTES, and there are no more parts than threads.
+ */
+static unsigned axc__parts__(uint64_t n, uint64_t width) {
+    uint64_t threads = threads_;
+    if (!threads) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? MIN((uint64_t) cpus, AXC_MAX_THREADS) : 1;
+    }
+    uint64_t parts = n * width / AXC_PARALLEL_BYTES;
+    return (unsigned) MAX(MIN(parts, threads), 1);
+}
+
+/**
+ * A part of the work of axc__parallel__.
+ */
+struct axctask {
+    void (*f)(void *, unsigned, uint64_t, uint64_t);
+    void *ctx;
+    unsigned part;
+    uint64_t begin;
+    uint64_t end;
+};
+
+static void *axc__taskWorker__(void *arg) {
+    struct axctask *task = arg;
+    task->f(task->ctx, task->part, task->begin, task->end);
+    return NULL;
+}
+
+/**
+ * Index at which the k-th of parts consecutive ranges covering [0, n) begins.
+ */
+static inline uint64_t axc__partBegin__(uint64_t n, unsigned parts, unsigned k) {
+    return n / parts * k + MIN(k, n % parts);
+}
+
+/**
+ * Splits [0, n) into parts consecutive ranges and calls f(ctx, part, begin, end) on each of them, one thread per part.
+ * The calling thread runs the first part and any part whose thread could not be created. Returns once all parts are
+ * done.
+ */
+static void axc__parallel__(unsigned parts, uint64_t n, void (*f)(void *, unsigned, uint64_t, uint64_t), void *ctx) {
+    if (parts <= 1) {
+        f(ctx, 0, 0, n);
+        return;
+    }
+    struct axctask tasks[AXC_MAX_THREADS];
+    pthread_t threads[AXC_MAX_THREADS];
+    bool started[AXC_MAX_THREADS];
+    for (unsigned k = 0; k < parts; ++k) {
+        tasks[k] = (struct axctask) {f, ctx, k, axc__partBegin__(n, parts, k), axc__partBegin__(n, parts, k + 1)};
+        started[k] = k && !pthread_create(&threads[k], NULL, axc__taskWorker__, &tasks[k]);
+    }
+    for (unsigned k = 0; k < parts; ++k) {
+        if (!started[k])
+            axc__taskWorker__(&tasks[k]);
+    }
+    for (unsigned k = 1; k < parts; ++k) {
+        if (started[k])
+            pthread_join(threads[k], NULL);
+    }
+}
+
+/**
+ * Index of the first dead chunk in [i, end), or end if there is none.
+ */
+static inline uint64_t axc__nextDead__(axchunk *c, uint64_t i, uint64_t end) {
+    if (!c->deadLen)
+        return end;
+    for (; i < end && i >> 6 < c->deadWords; i = (i | 63) + 1) {
+        uint64_t word = c->dead[i >> 6] >> (i & 63);
+        if (word)
+            return MIN(i + (uint64_t) __builtin_ctzll(word), end);
+    }
+    return end;
+}
+
+/**
+ * Index of the first live chunk in [i, end), or end if there is none.
+ */
+static inline uint64_t axc__nextLive__(axchunk *c, uint64_t i, uint64_t end) {
+    if (!c->deadLen)
+        return i;
+    for (; i < end && i >> 6 < c->deadWords; i = (i | 63) + 1) {
+        uint64_t word = ~c->dead[i >> 6] >> (i & 63);
+        if (word)
+            return MIN(i + (uint64_t) __builtin_ctzll(word), end);
+    }
+    return MIN(i, end);
+}
+
+/**
+ * Number of live chunks in [begin, end).
+ */
+static uint64_t axc__liveCount__(axchunk *c, uint64_t begin, uint64_t end) {
+    uint64_t live = end - begin;
+    if (!c->deadLen)
+        return live;
+    for (uint64_t i = begin; i < end && i >> 6 < c->deadWords; i = (i | 63) + 1) {
+        uint64_t word = c->dead[i >> 6] >> (i & 63);
+        if (end - i < 64)
+            word &= ((uint64_t) 1 << (end - i)) - 1;
+        live -= (uint64_t) __builtin_popcountll(word);
+    }
+    return live;
+}
+
+struct axcreduce {
+    axchunk *c;
+    void *acc;
+    char *accs;
+    uint64_t accWidth;
+    void (*identity)(void *, void *);
+    void (*fold)(void *, const void *, void *);
+    void *arg;
+};
+
+static void axc__reducePart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axcreduce *r = ctx;
+    axchunk *c = r->c;
+    void *acc = part ? r->accs + (part - 1) * r->accWidth : r->acc;
+    r->identity(acc, r->arg);
+    for (uint64_t i = axc__nextLive__(c, begin, end); i < end; i = axc__nextLive__(c, i, end)) {
+        for (const uint64_t run = axc__nextDead__(c, i, end); i < run; ++i)
+            r->fold(acc, axc__index__(c, i), r->arg);
+    }
+}
+
+void *axc_reduce(axchunk *c, void *acc, uint64_t accWidth, void (*identity)(void *, void *),
+                 void (*fold)(void *, const void *, void *), void (*combine)(void *, const void *, void *), void *arg) {
+    unsigned parts = combine ? axc__parts__(c->len, c->width) : 1;
+    char *accs = parts > 1 ? malloc_((parts - 1) * MAX(accWidth, 1)) : NULL;
+    if (!accs)
+        parts = 1;
+    struct axcreduce r = {c, acc, accs, accWidth, identity, fold, arg};
+    axc__parallel__(parts, c->len, axc__reducePart__, &r);
+    for (unsigned k = 1; k < parts; ++k)
+        combine(acc, accs + (k - 1) * accWidth, arg);
+    free_(accs);
+    return acc;
+}
+
+/**
+ * Typed folds over numeric fields.
+ */
+enum axcop {
+    AXC_OP_SUM,
+    AXC_OP_MIN,
+    AXC_OP_MAX,
+    AXC_OP_COUNT,
+};
+
+/*
+ * X-macro over all field types: suffix of the axctype, C type, member of axcnum holding a value and member of axcnum
+ * holding a sum. Integer sums are held unsigned so that they wrap around.
+ */
+#define AXC__TYPES__(X) \
+    X(I8, int8_t, i, u) X(I16, int16_t, i, u) X(I32, int32_t, i, u) X(I64, int64_t, i, u) \
+    X(U8, uint8_t, u, u) X(U16, uint16_t, u, u) X(U32, uint32_t, u, u) X(U64, uint64_t, u, u) \
+    X(F32, float, f, f) X(F64, double, f, f)
+
+static inline axcnum axc__load__(const char *p, axctype type) {
+    axcnum x = {0};
+    switch (type) {
+#define AXC__LOAD__(S, T, m, s) case AXC_##S: { T v; memcpy(&v, p, sizeof v); x.m = v; break; }
+    AXC__TYPES__(AXC__LOAD__)
+#undef AXC__LOAD__
+    }
+    return x;
+}
+
+static inline void axc__store__(char *p, axctype type, axcnum x) {
+    switch (type) {
+#define AXC__STORE__(S, T, m, s) case AXC_##S: { T v = (T) x.s; memcpy(p, &v, sizeof v); break; }
+    AXC__TYPES__(AXC__STORE__)
+#undef AXC__STORE__
+    }
+}
+
+/**
+ * Scalar fold of n fields, width bytes apart. Minima and maxima expect acc to hold a value of the field already.
+ */
+#define AXC__FOLD__(S, T, m, s) \
+static axcnum axc__fold##S##__(const char *p, uint64_t n, uint64_t width, int op, axcnum acc) { \
+    T x; \
+    switch (op) { \
+    case AXC_OP_SUM: \
+        for (uint64_t k = 0; k < n; ++k, p += width) { memcpy(&x, p, sizeof x); acc.s += x; } \
+        break; \
+    case AXC_OP_MIN: \
+        for (uint64_t k = 0; k < n; ++k, p += width) { memcpy(&x, p, sizeof x); if (x < acc.m || acc.m != acc.m) acc.m = x; } \
+        break; \
+    case AXC_OP_MAX: \
+        for (uint64_t k = 0; k < n; ++k, p += width) { memcpy(&x, p, sizeof x); if (x > acc.m || acc.m != acc.m) acc.m = x; } \
+        break; \
+    default: \
+        for (uint64_t k = 0; k < n; ++k, p += width) { memcpy(&x, p, sizeof x); acc.u += x != 0; } \
+        break; \
+    } \
+    return acc; \
+}
+AXC__TYPES__(AXC__FOLD__)
+#undef AXC__FOLD__
+
+#ifdef AXC_AVX2
+AXC_TARGET_AVX2 static inline uint64_t axc__hsum64__(__m256i v) {
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i *) lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+AXC_TARGET_AVX2 static inline double axc__hsumpd__(__m256d v) {
+    double lanes[4];
+    _mm256_storeu_pd(lanes, v);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+/**
+ * AVX2 sum of densely packed 4- and 8-byte fields, eight at a time. Returns the number of fields summed; the rest is
+ * left to the scalar fold.
+ */
+AXC_TARGET_AVX2 static uint64_t axc__sumAVX2__(const char *p, uint64_t n, axctype type, axcnum *acc) {
+    uint64_t k = 0;
+    __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+    __m256d d0 = _mm256_setzero_pd(), d1 = _mm256_setzero_pd();
+    switch (type) {
+    case AXC_I32:
+        for (; k + 8 <= n; k += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i *) (p + k * 4));
+            s0 = _mm256_add_epi64(s0, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+            s1 = _mm256_add_epi64(s1, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+        }
+        break;
+    case AXC_U32:
+        for (; k + 8 <= n; k += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i *) (p + k * 4));
+            s0 = _mm256_add_epi64(s0, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(v)));
+            s1 = _mm256_add_epi64(s1, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(v, 1)));
+        }
+        break;
+    case AXC_I64: case AXC_U64:
+        for (; k + 8 <= n; k += 8) {
+            s0 = _mm256_add_epi64(s0, _mm256_loadu_si256((const __m256i *) (p + k * 8)));
+            s1 = _mm256_add_epi64(s1, _mm256_loadu_si256((const __m256i *) (p + k * 8 + 32)));
+        }
+        break;
+    case AXC_F32:
+        for (; k + 8 <= n; k += 8) {
+            d0 = _mm256_add_pd(d0, _mm256_cvtps_pd(_mm_loadu_ps((const float *) (p + k * 4))));
+            d1 = _mm256_add_pd(d1, _mm256_cvtps_pd(_mm_loadu_ps((const float *) (p + k * 4 + 16))));
+        }
+        acc->f += axc__hsumpd__(_mm256_add_pd(d0, d1));
+        return k;
+    case AXC_F64:
+        for (; k + 8 <= n; k += 8) {
+            d0 = _mm256_add_pd(d0, _mm256_loadu_pd((const double *) (p + k * 8)));
+            d1 = _mm256_add_pd(d1, _mm256_loadu_pd((const double *) (p + k * 8 + 32)));
+        }
+        acc->f += axc__hsumpd__(_mm256_add_pd(d0, d1));
+        return k;
+    default:
+        return 0;
+    }
+    acc->u += axc__hsum64__(_mm256_add_epi64(s0, s1));
+    return k;
+}
+
+/**
+ * AVX2 minimum or maximum of densely packed 4-byte integers and floating-point numbers. acc must hold a value of the
+ * field already. Returns the number of fields handled.
+ */
+AXC_TARGET_AVX2 static uint64_t axc__minMaxAVX2__(const char *p, uint64_t n, axctype type, bool max, axcnum *acc) {
+    uint64_t k = 0;
+    switch (type) {
+    case AXC_I32: case AXC_U32: {
+        __m256i m = _mm256_set1_epi32(type == AXC_I32 ? (int32_t) acc->i : (int32_t) (uint32_t) acc->u);
+        for (; k + 8 <= n; k += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i *) (p + k * 4));
+            if (type == AXC_I32)
+                m = max ? _mm256_max_epi32(m, v) : _mm256_min_epi32(m, v);
+            else
+                m = max ? _mm256_max_epu32(m, v) : _mm256_min_epu32(m, v);
+        }
+        uint32_t lanes[8];
+        _mm256_storeu_si256((__m256i *) lanes, m);
+        for (int l = 0; l < 8; ++l) {
+            if (type == AXC_I32)
+                acc->i = max ? MAX(acc->i, (int32_t) lanes[l]) : MIN(acc->i, (int32_t) lanes[l]);
+            else
+                acc->u = max ? MAX(acc->u, lanes[l]) : MIN(acc->u, lanes[l]);
+        }
+        return k;
+    }
+    case AXC_F32: case AXC_F64: {
+        // the loaded values go first, so that a NaN among them yields the accumulator rather than the NaN
+        __m256d m = _mm256_set1_pd(acc->f);
+        const uint64_t step = type == AXC_F32 ? 4 : 8;
+        for (; k + 4 <= n; k += 4) {
+            __m256d v = type == AXC_F32 ? _mm256_cvtps_pd(_mm_loadu_ps((const float *) (p + k * step)))
+                                        : _mm256_loadu_pd((const double *) (p + k * step));
+            m = max ? _mm256_max_pd(v, m) : _mm256_min_pd(v, m);
+        }
+        double lanes[4];
+        _mm256_storeu_pd(lanes, m);
+        for (int l = 0; l < 4; ++l) {
+            if (max ? lanes[l] > acc->f : lanes[l] < acc->f)
+                acc->f = lanes[l];
+        }
+        return k;
+    }
+    default:
+        return 0;
+    }
+}
+#endif
+
+/**
+ * Fold of n fields, width bytes apart, into acc. Densely packed fields take the SIMD paths where there are any.
+ */
+static axcnum axc__foldRun__(const char *p, uint64_t n, uint64_t width, axctype type, int op, axcnum acc) {
+#ifdef AXC_AVX2
+    if (width == axc_typeSize(type) && op != AXC_OP_COUNT && !(type >= AXC_F32 && acc.f != acc.f)
+        && axc__hasAVX2__()) {
+        uint64_t k = op == AXC_OP_SUM ? axc__sumAVX2__(p, n, type, &acc)
+                                      : axc__minMaxAVX2__(p, n, type, op == AXC_OP_MAX, &acc);
+        p += k * width;
+        n -= k;
+    }
+#endif
+    switch (type) {
+#define AXC__FOLD_CASE__(S, T, m, s) case AXC_##S: return axc__fold##S##__(p, n, width, op, acc);
+    AXC__TYPES__(AXC__FOLD_CASE__)
+#undef AXC__FOLD_CASE__
+    }
+    return acc;
+}
+
+static axcnum axc__combine__(axctype type, int op, axcnum a, axcnum b) {
+    const bool isFloat = type >= AXC_F32;
+    switch (op) {
+    case AXC_OP_SUM:
+        if (isFloat)
+            a.f += b.f;
+        else
+            a.u += b.u;
+        break;
+    case AXC_OP_MIN:
+        if (isFloat ? b.f < a.f || a.f != a.f : type <= AXC_I64 ? b.i < a.i : b.u < a.u)
+            a = b;
+        break;
+    case AXC_OP_MAX:
+        if (isFloat ? b.f > a.f || a.f != a.f : type <= AXC_I64 ? b.i > a.i : b.u > a.u)
+            a = b;
+        break;
+    default:
+        a.u += b.u;
+        break;
+    }
+    return a;
+}
+
+struct axcfold {
+    axchunk *c;
+    uint64_t offset;
+    axctype type;
+    int op;
+    axcnum acc[AXC_MAX_THREADS];
+    bool any[AXC_MAX_THREADS];
+};
+
+static void axc__foldPart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axcfold *fold = ctx;
+    axchunk *c = fold->c;
+    const bool needsValue = fold->op == AXC_OP_MIN || fold->op == AXC_OP_MAX;
+    axcnum acc = {0};
+    bool any = false;
+    for (uint64_t i = axc__nextLive__(c, begin, end); i < end; i = axc__nextLive__(c, i, end)) {
+        const uint64_t run = axc__nextDead__(c, i, end);
+        const char *p = (char *) axc__index__(c, i) + fold->offset;
+        uint64_t n = run - i;
+        if (!any && needsValue) {
+            acc = axc__load__(p, fold->type);
+            p += c->width;
+            --n;
+        }
+        any = true;
+        acc = axc__foldRun__(p, n, c->width, fold->type, fold->op, acc);
+        i = run;
+    }
+    fold->acc[part] = acc;
+    fold->any[part] = any;
+}
+
+/**
+ * Typed fold over all live chunks, in parallel for large axchunks. The field must fit into a chunk.
+ */
+static axcnum axc__fold__(axchunk *c, uint64_t offset, axctype type, int op) {
+    struct axcfold fold = {.c = c, .offset = offset, .type = type, .op = op};
+    const unsigned parts = axc__parts__(c->len, c->width);
+    axc__parallel__(parts, c->len, axc__foldPart__, &fold);
+    axcnum acc = {0};
+    bool any = false;
+    for (unsigned k = 0; k < parts; ++k) {
+        if (fold.any[k])
+            acc = any ? axc__combine__(type, op, acc, fold.acc[k]) : fold.acc[k];
+        any |= fold.any[k];
+    }
+    return acc;
+}
+
+axcnum axc_sum(axchunk *c, uint64_t offset, axctype type) {
+    if (offset + axc_typeSize(type) > c->width)
+        return (axcnum) {0};
+    return axc__fold__(c, offset, type, AXC_OP_SUM);
+}
+
+axcnum axc_min(axchunk *c, uint64_t offset, axctype type) {
+    if (offset + axc_typeSize(type) > c->width)
+        return (axcnum) {0};
+    return axc__fold__(c, offset, type, AXC_OP_MIN);
+}
+
+axcnum axc_max(axchunk *c, uint64_t offset, axctype type) {
+    if (offset + axc_typeSize(type) > c->width)
+        return (axcnum) {0};
+    return axc__fold__(c, offset, type, AXC_OP_MAX);
+}
+
+uint64_t axc_count(axchunk *c, uint64_t offset, axctype type) {
+    if (offset + axc_typeSize(type) > c->width)
+        return 0;
+    return axc__fold__(c, offset, type, AXC_OP_COUNT).u;
+}
+
+/**
+ * Scalar prefix sum of n fields, srcWidth bytes apart, into values dstWidth bytes apart, starting from acc.
+ */
+#define AXC__SCAN__(S, T, m, s) \
+static axcnum axc__scan##S##__(const char *src, uint64_t srcWidth, char *dst, uint64_t dstWidth, uint64_t n, \
+                               bool exclusive, axcnum acc) { \
+    for (uint64_t k = 0; k < n; ++k, src += srcWidth, dst += dstWidth) { \
+        T x, y; \
+        memcpy(&x, src, sizeof x); \
+        if (exclusive) { \
+            y = (T) acc.s; \
+            acc.s += x; \
+        } else { \
+            acc.s += x; \
+            y = (T) acc.s; \
+        } \
+        memcpy(dst, &y, sizeof y); \
+    } \
+    return acc; \
+}
+AXC__TYPES__(AXC__SCAN__)
+#undef AXC__SCAN__
+
+struct axcscan {
+    axchunk *c;
+    uint64_t offset;
+    axctype type;
+    bool exclusive;
+    char *dst;
+    uint64_t dstWidth;
+    axcnum carry[AXC_MAX_THREADS];
+};
+
+static void axc__scanPart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axcscan *scan = ctx;
+    axchunk *c = scan->c;
+    axcnum acc = scan->carry[part];
+    for (uint64_t i = begin; i < end;) {
+        const uint64_t run = axc__nextDead__(c, i, end);
+        const char *src = (char *) axc__index__(c, i) + scan->offset;
+        char *dst = scan->dst + i * scan->dstWidth;
+        switch (scan->type) {
+#define AXC__SCAN_CASE__(S, T, m, s) \
+        case AXC_##S: acc = axc__scan##S##__(src, c->width, dst, scan->dstWidth, run - i, scan->exclusive, acc); break;
+        AXC__TYPES__(AXC__SCAN_CASE__)
+#undef AXC__SCAN_CASE__
+        }
+        // dead chunks add nothing and get the running sum
+        i = run;
+        for (const uint64_t live = axc__nextLive__(c, i, end); i < live; ++i)
+            axc__store__(scan->dst + i * scan->dstWidth, scan->type, acc);
+    }
+}
+
+bool axc_prefixSum(axchunk *c, uint64_t offset, axctype type, bool exclusive, void *dst) {
+    if (offset + axc_typeSize(type) > c->width)
+        return true;
+    struct axcscan scan = {c, offset, type, exclusive, dst, axc_typeSize(type), {{0}}};
+    if (!dst) {
+        scan.dst = (char *) c->chunks + offset;
+        scan.dstWidth = c->width;
+        axc__markDirty__(c, 0, c->len);
+    }
+    const unsigned parts = axc__parts__(c->len, c->width);
+    if (parts > 1) {
+        // sum up every part first to know where the prefix sums of the next part start
+        struct axcfold fold = {.c = c, .offset = offset, .type = type, .op = AXC_OP_SUM};
+        axc__parallel__(parts, c->len, axc__foldPart__, &fold);
+        for (unsigned k = 1; k < parts; ++k)
+            scan.carry[k] = axc__combine__(type, AXC_OP_SUM, scan.carry[k - 1], fold.acc[k - 1]);
+    }
+    axc__parallel__(parts, c->len, axc__scanPart__, &scan);
+    if (!dst && c->journal)
+        axc__journalRange__(c, AXC_RECORD_PATCH, 0, c->len);
+    return false;
+}
+
+struct axcmap {
+    axchunk *src;
+    axchunk *dst;
+    void (*f)(const void *, void *, uint64_t, void *);
+    void *arg;
+    uint64_t first[AXC_MAX_THREADS];
+};
+
+static void axc__mapPart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axcmap *map = ctx;
+    axchunk *src = map->src;
+    uint64_t out = map->first[part];
+    for (uint64_t i = axc__nextLive__(src, begin, end); i < end; i = axc__nextLive__(src, i, end)) {
+        const uint64_t run = axc__nextDead__(src, i, end);
+        map->f(axc__index__(src, i), axc__index__(map->dst, out), run - i, map->arg);
+        out += run - i;
+        i = run;
+    }
+}
+
+/**
+ * Shared by axc_map and axc_mapParallel. Every part writes to the destination from the number of live chunks before it.
+ */
+static axchunk *axc__map__(axchunk *src, uint64_t dstWidth, void (*f)(const void *, void *, uint64_t, void *),
+                           void *arg, unsigned parts) {
+    const uint64_t len = src->len - src->deadLen;
+    axchunk *dst = axc_newSized(dstWidth, len);
+    if (!dst)
+        return NULL;
+    struct axcmap map = {src, dst, f, arg, {0}};
+    for (unsigned k = 1; k < parts; ++k) {
+        map.first[k] = map.first[k - 1] + axc__liveCount__(src, axc__partBegin__(src->len, parts, k - 1),
+                                                           axc__partBegin__(src->len, parts, k));
+    }
+    axc__parallel__(parts, src->len, axc__mapPart__, &map);
+    dst->len = len;
+    return dst;
+}
+
+axchunk *axc_map(axchunk *src, uint64_t dstWidth, void (*f)(const void *, void *, uint64_t, void *), void *arg) {
+    return axc__map__(src, dstWidth, f, arg, 1);
+}
+
+axchunk *axc_mapParallel(axchunk *src, uint64_t dstWidth, void (*f)(const void *, void *, uint64_t, void *),
+                         void *arg) {
+    return axc__map__(src, dstWidth, f, arg, axc__parts__(src->len, src->width + dstWidth));
+}
+
+/**
+ * A live chunk by index, along with the hash of its key.
+ */
+struct axcrow {
+    uint64_t hash;
+    uint64_t index;
+};
+
+/**
+ * Live chunks of an axchunk radix partitioned by the top bits of the hashes of their keys. The rows of partition p are
+ * rows[starts[p]] to rows[starts[p + 1] - 1].
+ */
+struct axcpartition {
+    axchunk *c;
+    uint64_t keyOffset;
+    uint64_t keyWidth;
+    uint64_t npartitions;
+    unsigned shift;
+    unsigned parts;
+    uint64_t *hashes;
+    uint64_t *counts;
+    uint64_t *starts;
+    struct axcrow *rows;
+};
+
+/**
+ * Number of partitions to split n rows into so that the rows of a partition fit into AXC_PARTITION_BYTES. Always a
+ * power of two.
+ */
+static uint64_t axc__partitions__(uint64_t n) {
+    uint64_t partitions = 1;
+    while (partitions < AXC_MAX_PARTITIONS && n * sizeof(struct axcrow) / partitions > AXC_PARTITION_BYTES)
+        partitions <<= 1;
+    return partitions;
+}
+
+static inline uint64_t axc__keyHash__(const char *key, uint64_t keyWidth) {
+    return axc_hash(key, keyWidth, 0);
+}
+
+static void axc__histogramPart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axcpartition *pt = ctx;
+    axchunk *c = pt->c;
+    uint64_t *counts = pt->counts + part * pt->npartitions;
+    for (uint64_t i = axc__nextLive__(c, begin, end); i < end; i = axc__nextLive__(c, i, end)) {
+        for (const uint64_t run = axc__nextDead__(c, i, end); i < run; ++i) {
+            uint64_t hash = axc__keyHash__((char *) axc__index__(c, i) + pt->keyOffset, pt->keyWidth);
+            pt->hashes[i] = hash;
+            ++counts[hash >> pt->shift];
+        }
+    }
+}
+
+static void axc__scatterPart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axcpartition *pt = ctx;
+    axchunk *c = pt->c;
+    uint64_t *next = pt->counts + part * pt->npartitions;
+    for (uint64_t i = axc__nextLive__(c, begin, end); i < end; i = axc__nextLive__(c, i, end)) {
+        for (const uint64_t run = axc__nextDead__(c, i, end); i < run; ++i) {
+            uint64_t hash = pt->hashes[i];
+            pt->rows[next[hash >> pt->shift]++] = (struct axcrow) {hash, i};
+        }
+    }
+}
+
+static void axc__releasePartition__(struct axcpartition *pt) {
+    free_(pt->hashes);
+    free_(pt->counts);
+    free_(pt->starts);
+    free_(pt->rows);
+}
+
+/**
+ * Radix partitions the live chunks of an axchunk into npartitions partitions, which must be a power of two greater
+ * than one. A histogram pass hashes every key and counts the rows of every partition per thread, and a scatter pass
+ * moves the rows to where the counts put them. Returns true iff OOM.
+ */
+static bool axc__partition__(struct axcpartition *pt, axchunk *c, uint64_t keyOffset, uint64_t keyWidth,
+                             uint64_t npartitions) {
+    *pt = (struct axcpartition) {.c = c, .keyOffset = keyOffset, .keyWidth = keyWidth, .npartitions = npartitions,
+                                 .shift = 64 - (unsigned) __builtin_ctzll(npartitions),
+                                 .parts = axc__parts__(c->len, c->width)};
+    pt->hashes = malloc_(MAX(c->len, 1) * sizeof *pt->hashes);
+    pt->counts = malloc_(pt->parts * npartitions * sizeof *pt->counts);
+    pt->starts = malloc_((npartitions + 1) * sizeof *pt->starts);
+    pt->rows = malloc_(MAX(c->len - c->deadLen, 1) * sizeof *pt->rows);
+    if (!pt->hashes || !pt->counts || !pt->starts || !pt->rows) {
+        axc__releasePartition__(pt);
+        return true;
+    }
+    memset(pt->counts, 0, pt->parts * npartitions * sizeof *pt->counts);
+    axc__parallel__(pt->parts, c->len, axc__histogramPart__, pt);
+
+    // turn the counts into the index at which every thread starts writing the rows of every partition
+    uint64_t next = 0;
+    for (uint64_t p = 0; p < npartitions; ++p) {
+        pt->starts[p] = next;
+        for (unsigned k = 0; k < pt->parts; ++k) {
+            uint64_t count = pt->counts[k * npartitions + p];
+            pt->counts[k * npartitions + p] = next;
+            next += count;
+        }
+    }
+    pt->starts[npartitions] = next;
+    axc__parallel__(pt->parts, c->len, axc__scatterPart__, pt);
+    return false;
+}
+
+/**
+ * Slot of an open-addressing hash table. Holds the index of an entry plus one, or zero if empty.
+ */
+struct axcslot {
+    uint64_t hash;
+    uint64_t entry;
+};
+
+struct axctable {
+    struct axcslot *slots;
+    uint64_t mask;
+    uint64_t used;
+};
+
+static bool axc__newTable__(struct axctable *t, uint64_t slots) {
+    t->slots = malloc_(slots * sizeof *t->slots);
+    t->mask = slots - 1;
+    t->used = 0;
+    if (t->slots)
+        memset(t->slots, 0, slots * sizeof *t->slots);
+    return !t->slots;
+}
+
+static void axc__resetTable__(struct axctable *t) {
+    if (t->used)
+        memset(t->slots, 0, (t->mask + 1) * sizeof *t->slots);
+    t->used = 0;
+}
+
+/**
+ * Makes sure the table has room for one more entry while staying at most half full. Returns true iff OOM.
+ */
+static bool axc__reserveTable__(struct axctable *t) {
+    if ((t->used + 1) * 2 <= t->mask + 1)
+        return false;
+    const uint64_t mask = (t->mask << 1) | 1;
+    struct axcslot *slots = malloc_((mask + 1) * sizeof *slots);
+    if (!slots)
+        return true;
+    memset(slots, 0, (mask + 1) * sizeof *slots);
+    for (uint64_t s = 0; s <= t->mask; ++s) {
+        if (!t->slots[s].entry)
+            continue;
+        uint64_t slot = t->slots[s].hash & mask;
+        while (slots[slot].entry)
+            slot = (slot + 1) & mask;
+        slots[slot] = t->slots[s];
+    }
+    free_(t->slots);
+    t->slots = slots;
+    t->mask = mask;
+    return false;
+}
+
+/**
+ * Concatenates the outputs of several threads into one axchunk and destroys the rest of them. Returns NULL if any
+ * thread failed or on OOM.
+ */
+static axchunk *axc__concat__(axchunk **out, const bool *failed, unsigned parts, uint64_t width) {
+    uint64_t total = 0;
+    bool anyFailed = false;
+    for (unsigned k = 0; k < parts; ++k) {
+        anyFailed |= failed[k];
+        total += out[k] ? out[k]->len : 0;
+    }
+    axchunk *result = anyFailed ? NULL : parts == 1 ? out[0] : axc_newSized(width, total);
+    if (result && result != out[0]) {
+        for (unsigned k = 0; k < parts; ++k) {
+            axc__bulkcopy__(axc__index__(result, result->len), out[k]->chunks, out[k]->len * width);
+            result->len += out[k]->len;
+        }
+    }
+    for (unsigned k = 0; k < parts; ++k) {
+        if (out[k] && out[k] != result)
+            axc_destroy(out[k]);
+    }
+    return result;
+}
+
+/**
+ * State of axc_groupBy. Every thread collects its groups in its own axchunk.
+ */
+struct axcgroupby {
+    axchunk *c;
+    uint64_t keyOffset;
+    uint64_t keyWidth;
+    const axcaggregate *aggs;
+    uint64_t naggs;
+    struct axcpartition *pt;
+    axchunk *out[AXC_MAX_THREADS];
+    bool failed[AXC_MAX_THREADS];
+};
+
+static inline axcnum axc__aggValue__(const axcaggregate *agg, const char *chunk) {
+    return agg->fn == AXC_AGG_COUNT ? (axcnum) {.u = 1} : axc__load__(chunk + agg->offset, agg->type);
+}
+
+/**
+ * Aggregates rows into the groups of out, looking the groups up in t. Returns true iff OOM.
+ */
+static bool axc__groupRows__(struct axcgroupby *g, struct axctable *t, axchunk *out, const struct axcrow *rows,
+                             uint64_t n) {
+    static const int ops[] = {AXC_OP_SUM, AXC_OP_MIN, AXC_OP_MAX, AXC_OP_COUNT};
+    for (uint64_t r = 0; r < n; ++r) {
+        const char *chunk = axc__index__(g->c, rows[r].index);
+        const char *key = chunk + g->keyOffset;
+        uint64_t slot = rows[r].hash & t->mask;
+        char *group = NULL;
+        for (; t->slots[slot].entry; slot = (slot + 1) & t->mask) {
+            char *candidate = axc__index__(out, t->slots[slot].entry - 1);
+            if (t->slots[slot].hash == rows[r].hash && !memcmp(candidate, key, g->keyWidth)) {
+                group = candidate;
+                break;
+            }
+        }
+        if (group) {
+            for (uint64_t a = 0; a < g->naggs; ++a) {
+                axcnum acc;
+                char *field = group + g->keyWidth + a * sizeof acc;
+                memcpy(&acc, field, sizeof acc);
+                acc = axc__combine__(g->aggs[a].type, ops[g->aggs[a].fn], acc, axc__aggValue__(&g->aggs[a], chunk));
+                memcpy(field, &acc, sizeof acc);
+            }
+            continue;
+        }
+        if (axc__reserveTable__(t) || (out->len >= out->cap && axc_resize(out, (out->cap << 1) | 1)))
+            return true;
+        for (slot = rows[r].hash & t->mask; t->slots[slot].entry; slot = (slot + 1) & t->mask);
+        group = axc__index__(out, out->len++);
+        memcpy(group, key, g->keyWidth);
+        for (uint64_t a = 0; a < g->naggs; ++a) {
+            axcnum acc = axc__aggValue__(&g->aggs[a], chunk);
+            memcpy(group + g->keyWidth + a * sizeof acc, &acc, sizeof acc);
+        }
+        t->slots[slot] = (struct axcslot) {rows[r].hash, out->len};
+        ++t->used;
+    }
+    return false;
+}
+
+static void axc__groupPart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axcgroupby *g = ctx;
+    struct axctable t;
+    g->out[part] = axc_new(g->keyWidth + g->naggs * sizeof(axcnum));
+    if (!g->out[part] || axc__newTable__(&t, AXC_TABLE_SLOTS)) {
+        g->failed[part] = true;
+        return;
+    }
+    for (uint64_t p = begin; p < end && !g->failed[part]; ++p) {
+        axc__resetTable__(&t);
+        const uint64_t first = g->pt->starts[p];
+        g->failed[part] = axc__groupRows__(g, &t, g->out[part], g->pt->rows + first, g->pt->starts[p + 1] - first);
+    }
+    free_(t.slots);
+}
+
+axchunk *axc_groupBy(axchunk *c, uint64_t keyOffset, uint64_t keyWidth, const axcaggregate *aggs, uint64_t naggs) {
+    if (keyOffset + keyWidth > c->width)
+        return NULL;
+    for (uint64_t a = 0; a < naggs; ++a) {
+        if (aggs[a].fn != AXC_AGG_COUNT && aggs[a].offset + axc_typeSize(aggs[a].type) > c->width)
+            return NULL;
+    }
+    struct axcgroupby g = {.c = c, .keyOffset = keyOffset, .keyWidth = keyWidth, .aggs = aggs, .naggs = naggs};
+    const uint64_t npartitions = axc__partitions__(c->len - c->deadLen);
+
+    if (npartitions == 1) {
+        // small enough for a single table that fits into the cache; rows are hashed a batch at a time
+        struct axctable t;
+        struct axcrow rows[AXC_BATCH];
+        uint64_t n = 0;
+        g.out[0] = axc_new(keyWidth + naggs * sizeof(axcnum));
+        if (!g.out[0] || axc__newTable__(&t, AXC_TABLE_SLOTS)) {
+            if (g.out[0])
+                axc_destroy(g.out[0]);
+            return NULL;
+        }
+        for (uint64_t i = axc__nextLive__(c, 0, c->len); i < c->len; i = axc__nextLive__(c, i, c->len)) {
+            for (const uint64_t run = axc__nextDead__(c, i, c->len); i < run; ++i) {
+                rows[n++] = (struct axcrow) {axc__keyHash__((char *) axc__index__(c, i) + keyOffset, keyWidth), i};
+                if (n == AXC_BATCH && !g.failed[0]) {
+                    g.failed[0] = axc__groupRows__(&g, &t, g.out[0], rows, n);
+                    n = 0;
+                }
+            }
+        }
+        if (!g.failed[0])
+            g.failed[0] = axc__groupRows__(&g, &t, g.out[0], rows, n);
+        free_(t.slots);
+        if (g.failed[0]) {
+            axc_destroy(g.out[0]);
+            return NULL;
+        }
+        return g.out[0];
+    }
+
+    struct axcpartition pt;
+    if (axc__partition__(&pt, c, keyOffset, keyWidth, npartitions))
+        return NULL;
+    g.pt = &pt;
+    const unsigned parts = (unsigned) MIN(pt.parts, npartitions);
+    axc__parallel__(parts, npartitions, axc__groupPart__, &g);
+    axc__releasePartition__(&pt);
+
+    // every group lives in exactly one partition, so the groups of all threads are simply concatenated
+    return axc__concat__(g.out, g.failed, parts, keyWidth + naggs * sizeof(axcnum));
+}
+
+/**
+ * State of axc_hashJoin. Every thread emits its matches into its own axchunk.
+ */
+struct axcjoin {
+    axchunk *left;
+    axchunk *right;
+    uint64_t leftKeyOffset;
+    uint64_t rightKeyOffset;
+    uint64_t keyWidth;
+    bool indices;
+    struct axcpartition *lp;
+    struct axcpartition *rp;
+    struct axctable *shared;
+    axchunk *out[AXC_MAX_THREADS];
+    bool failed[AXC_MAX_THREADS];
+};
+
+/**
+ * Inserts rows of the left axchunk into t. Rows with equal keys get an entry each. Returns true iff OOM.
+ */
+static bool axc__buildRows__(struct axctable *t, const struct axcrow *rows, uint64_t n) {
+    for (uint64_t r = 0; r < n; ++r) {
+        if (axc__reserveTable__(t))
+            return true;
+        uint64_t slot = rows[r].hash & t->mask;
+        while (t->slots[slot].entry)
+            slot = (slot + 1) & t->mask;
+        t->slots[slot] = (struct axcslot) {rows[r].hash, rows[r].index + 1};
+        ++t->used;
+    }
+    return false;
+}
+
+/**
+ * Looks up rows of the right axchunk in t and emits every match into out. Returns true iff OOM.
+ */
+static bool axc__probeRows__(struct axcjoin *j, const struct axctable *t, axchunk *out, const struct axcrow *rows,
+                             uint64_t n) {
+    for (uint64_t r = 0; r < n; ++r) {
+        const char *right = axc__index__(j->right, rows[r].index);
+        for (uint64_t slot = rows[r].hash & t->mask; t->slots[slot].entry; slot = (slot + 1) & t->mask) {
+            const uint64_t l = t->slots[slot].entry - 1;
+            const char *left = axc__index__(j->left, l);
+            if (t->slots[slot].hash != rows[r].hash
+                || memcmp(left + j->leftKeyOffset, right + j->rightKeyOffset, j->keyWidth))
+                continue;
+            if (out->len >= out->cap && axc_resize(out, (out->cap << 1) | 1))
+                return true;
+            char *match = axc__index__(out, out->len++);
+            if (j->indices) {
+                uint64_t pair[2] = {l, rows[r].index};
+                memcpy(match, pair, sizeof pair);
+            } else {
+                memcpy(match, left, j->left->width);
+                memcpy(match + j->left->width, right, j->right->width);
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Hashes the live chunks of [begin, end) of c a batch at a time and passes every batch to build or probe.
+ */
+static bool axc__joinBatches__(struct axcjoin *j, struct axctable *t, axchunk *out, axchunk *c, uint64_t keyOffset,
+                               uint64_t begin, uint64_t end) {
+    struct axcrow rows[AXC_BATCH];
+    uint64_t n = 0;
+    for (uint64_t i = axc__nextLive__(c, begin, end); i < end; i = axc__nextLive__(c, i, end)) {
+        for (const uint64_t run = axc__nextDead__(c, i, end); i < run; ++i) {
+            rows[n++] = (struct axcrow) {axc__keyHash__((char *) axc__index__(c, i) + keyOffset, j->keyWidth), i};
+            if (n == AXC_BATCH) {
+                if (out ? axc__probeRows__(j, t, out, rows, n) : axc__buildRows__(t, rows, n))
+                    return true;
+                n = 0;
+            }
+        }
+    }
+    return out ? axc__probeRows__(j, t, out, rows, n) : axc__buildRows__(t, rows, n);
+}
+
+/**
+ * Probes a range of the right axchunk against the shared table of the whole left axchunk.
+ */
+static void axc__probePart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axcjoin *j = ctx;
+    const uint64_t width = j->indices ? 2 * sizeof(uint64_t) : j->left->width + j->right->width;
+    j->out[part] = axc_new(width);
+    j->failed[part] = !j->out[part]
+                      || axc__joinBatches__(j, j->shared, j->out[part], j->right, j->rightKeyOffset, begin, end);
+}
+
+/**
+ * Joins a range of partitions, building a table from the left rows of every partition and probing it with the right
+ * rows of the same partition.
+ */
+static void axc__joinPart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axcjoin *j = ctx;
+    const uint64_t width = j->indices ? 2 * sizeof(uint64_t) : j->left->width + j->right->width;
+    struct axctable t;
+    j->out[part] = axc_new(width);
+    if (!j->out[part] || axc__newTable__(&t, AXC_TABLE_SLOTS)) {
+        j->failed[part] = true;
+        return;
+    }
+    for (uint64_t p = begin; p < end && !j->failed[part]; ++p) {
+        axc__resetTable__(&t);
+        const uint64_t leftFirst = j->lp->starts[p];
+        const uint64_t rightFirst = j->rp->starts[p];
+        j->failed[part] = axc__buildRows__(&t, j->lp->rows + leftFirst, j->lp->starts[p + 1] - leftFirst)
+                          || axc__probeRows__(j, &t, j->out[part], j->rp->rows + rightFirst,
+                                              j->rp->starts[p + 1] - rightFirst);
+    }
+    free_(t.slots);
+}
+
+axchunk *axc_hashJoin(axchunk *left, uint64_t leftKeyOffset, axchunk *right, uint64_t rightKeyOffset,
+                      uint64_t keyWidth, bool indices) {
+    if (leftKeyOffset + keyWidth > left->width || rightKeyOffset + keyWidth > right->width)
+        return NULL;
+    struct axcjoin j = {.left = left, .right = right, .leftKeyOffset = leftKeyOffset,
+                        .rightKeyOffset = rightKeyOffset, .keyWidth = keyWidth, .indices = indices};
+    const uint64_t width = indices ? 2 * sizeof(uint64_t) : left->width + right->width;
+    const uint64_t npartitions = axc__partitions__(left->len - left->deadLen);
+
+    if (npartitions == 1) {
+        // the table of the left axchunk fits into the cache as a whole and is shared by all threads probing it
+        struct axctable t;
+        if (axc__newTable__(&t, AXC_TABLE_SLOTS))
+            return NULL;
+        if (axc__joinBatches__(&j, &t, NULL, left, leftKeyOffset, 0, left->len)) {
+            free_(t.slots);
+            return NULL;
+        }
+        j.shared = &t;
+        const unsigned parts = axc__parts__(right->len, right->width);
+        axc__parallel__(parts, right->len, axc__probePart__, &j);
+        free_(t.slots);
+        return axc__concat__(j.out, j.failed, parts, width);
+    }
+
+    struct axcpartition lp, rp;
+    if (axc__partition__(&lp, left, leftKeyOffset, keyWidth, npartitions))
+        return NULL;
+    if (axc__partition__(&rp, right, rightKeyOffset, keyWidth, npartitions)) {
+        axc__releasePartition__(&lp);
+        return NULL;
+    }
+    j.lp = &lp;
+    j.rp = &rp;
+    const unsigned parts = (unsigned) MIN(MAX(lp.parts, rp.parts), npartitions);
+    axc__parallel__(parts, npartitions, axc__joinPart__, &j);
+    axc__releasePartition__(&lp);
+    axc__releasePartition__(&rp);
+    return axc__concat__(j.out, j.failed, parts, width);
+}
+
+axchunk *axc_dedupHashed(axchunk *c) {
+    // sized for every live chunk up front, so the table never grows and nothing can fail halfway through
+    uint64_t slots = AXC_TABLE_SLOTS;
+    while (slots < 2 * (c->len - c->deadLen))
+        slots <<= 1;
+    struct axctable t;
+    if (axc__newTable__(&t, slots))
+        return NULL;
+    const bool hasDead = c->deadLen;
+    char *chunk = c->chunks;
+    uint64_t kept = 0;
+    uint64_t firstRemoved = c->len;
+    uint64_t *keptBits = axc__keptBitmap__(c);
+    for (uint64_t i = 0; i < c->len; ++i, chunk += c->width) {
+        bool duplicate = hasDead && axc__isDead__(c, i);
+        const uint64_t hash = axc_hash(chunk, c->width, 0);
+        uint64_t slot = hash & t.mask;
+        for (; !duplicate && t.slots[slot].entry; slot = (slot + 1) & t.mask) {
+            duplicate = t.slots[slot].hash == hash
+                        && !memcmp(axc__index__(c, t.slots[slot].entry - 1), chunk, c->width);
+        }
+        if (duplicate) {
+            firstRemoved = MIN(firstRemoved, i);
+            if (c->destroy)
+                c->destroy(chunk);
+            continue;
+        }
+        if (kept != i)
+            memcpy(axc__index__(c, kept), chunk, c->width);
+        t.slots[slot] = (struct axcslot) {hash, ++kept};
+        if (keptBits)
+            keptBits[i >> 6] |= (uint64_t) 1 << (i & 63);
+    }
+    free_(t.slots);
+    axc__markDirty__(c, firstRemoved, c->len);
+    axc__journalKept__(c, keptBits, c->len, firstRemoved);
+    c->len = kept;
+    if (hasDead) {
+        memset(c->dead, 0, c->deadWords * sizeof *c->dead);
+        c->deadLen = 0;
+    }
+    return c;
+}
+
+struct axcfingerprint {
+    const char *data;
+    uint64_t size;
+    uint64_t sums[AXC_MAX_THREADS];
+};
+
+/**
+ * Hashes a range of blocks. Every block hash is mixed with the index of its block, so that the sum of all of them
+ * depends on the order of the blocks, but not on how they are spread over threads.
+ */
+static void axc__fingerprintPart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axcfingerprint *fp = ctx;
+    uint64_t sum = 0;
+    for (uint64_t b = begin; b < end; ++b) {
+        const uint64_t offset = b * AXC_FINGERPRINT_BLOCK;
+        const uint64_t hash = axc__hash__(fp->data + offset, MIN((uint64_t) AXC_FINGERPRINT_BLOCK, fp->size - offset), b);
+        sum += axc__mum__(hash, b ^ 0xe7037ed1a0b428dbull);
+    }
+    fp->sums[part] = sum;
+}
+
+uint64_t axc_fingerprint(axchunk *c) {
+    struct axcfingerprint fp = {c->chunks, c->len * c->width, {0}};
+    const uint64_t blocks = (fp.size + AXC_FINGERPRINT_BLOCK - 1) / AXC_FINGERPRINT_BLOCK;
+    const unsigned parts = axc__parts__(blocks, AXC_FINGERPRINT_BLOCK);
+    axc__parallel__(parts, blocks, axc__fingerprintPart__, &fp);
+    uint64_t summary[3] = {0, c->len, c->width};
+    for (unsigned k = 0; k < parts; ++k)
+        summary[0] += fp.sums[k];
+    return axc__hash__(summary, sizeof summary, 0);
+}
+
+#ifdef AXC_AVX2
+/**
+ * AVX2 version of axc__equalBytes__.
+ */
+AXC_TARGET_AVX2 static bool axc__equalBytesAVX2__(const char *a, const char *b, uint64_t n) {
+    for (; n >= 64; n -= 64, a += 64, b += 64) {
+        __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) a),
+                                     _mm256_loadu_si256((const __m256i *) b));
+        __m256i y = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (a + 32)),
+                                     _mm256_loadu_si256((const __m256i *) (b + 32)));
+        __m256i z = _mm256_or_si256(x, y);
+        if (!_mm256_testz_si256(z, z))
+            return false;
+    }
+    return !memcmp(a, b, n);
+}
+#endif
+
+/**
+ * Whether n bytes are equal. Compares 64 bytes at a time with SIMD and stops at the first block that differs.
+ */
+static bool axc__equalBytes__(const char *a, const char *b, uint64_t n) {
+#ifdef AXC_AVX2
+    if (axc__hasAVX2__())
+        return axc__equalBytesAVX2__(a, b, n);
+#endif
+#ifdef __SSE2__
+    for (; n >= 64; n -= 64, a += 64, b += 64) {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) a), _mm_loadu_si128((const __m128i *) b));
+        for (int k = 16; k < 64; k += 16) {
+            eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (a + k)),
+                                                  _mm_loadu_si128((const __m128i *) (b + k))));
+        }
+        if (_mm_movemask_epi8(eq) != 0xFFFF)
+            return false;
+    }
+#endif
+    return !memcmp(a, b, n);
+}
+
+/**
+ * State of axc_equal and axc_diff, which compare the first len chunks of two axchunks in blocks of step chunks.
+ */
+struct axccompare {
+    axchunk *a;
+    axchunk *b;
+    uint64_t step;
+    atomic_bool differs;
+    axchunk *out[AXC_MAX_THREADS];
+    bool failed[AXC_MAX_THREADS];
+};
+
+static void axc__equalPart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axccompare *cmp = ctx;
+    (void) part;
+    for (uint64_t i = begin; i < end && !atomic_load_explicit(&cmp->differs, memory_order_relaxed); i += cmp->step) {
+        const uint64_t n = MIN(cmp->step, end - i);
+        if (!axc__equalBytes__(axc__index__(cmp->a, i), axc__index__(cmp->b, i), n * cmp->a->width))
+            atomic_store_explicit(&cmp->differs, true, memory_order_relaxed);
+    }
+}
+
+bool axc_equal(axchunk *a, axchunk *b) {
+    if (a == b)
+        return true;
+    if (a->width != b->width || a->len != b->len)
+        return false;
+    struct axccompare cmp = {.a = a, .b = b, .step = MAX(AXC_COMPARE_BLOCK / a->width, 1)};
+    atomic_init(&cmp.differs, false);
+    axc__parallel__(axc__parts__(a->len, a->width), a->len, axc__equalPart__, &cmp);
+    return !atomic_load(&cmp.differs);
+}
+
+/**
+ * Collects the indices of the differing chunks of a range. Blocks that are equal as a whole are skipped, and only the
+ * chunks of the other blocks are compared one by one.
+ */
+static void axc__diffPart__(void *ctx, unsigned part, uint64_t begin, uint64_t end) {
+    struct axccompare *cmp = ctx;
+    const uint64_t width = cmp->a->width;
+    axchunk *out = cmp->out[part] = axc_new(sizeof(uint64_t));
+    if (!out) {
+        cmp->failed[part] = true;
+        return;
+    }
+    for (uint64_t i = begin; i < end; i += cmp->step) {
+        const uint64_t n = MIN(cmp->step, end - i);
+        const char *a = axc__index__(cmp->a, i);
+        const char *b = axc__index__(cmp->b, i);
+        if (axc__equalBytes__(a, b, n * width))
+            continue;
+        for (uint64_t k = 0; k < n; ++k, a += width, b += width) {
+            uint64_t index = i + k;
+            if (memcmp(a, b, width) && axc_push(out, &index)) {
+                cmp->failed[part] = true;
+                return;
+            }
+        }
+    }
+}
+
+bool axc_diff(axchunk *a, axchunk *b, axchunk *outIndices) {
+    if (a->width != b->width || outIndices->width != sizeof(uint64_t))
+        return true;
+    const uint64_t len = MIN(a->len, b->len);
+    const uint64_t longer = MAX(a->len, b->len);
+    struct axccompare cmp = {.a = a, .b = b, .step = MAX(AXC_COMPARE_BLOCK / a->width, 1)};
+    atomic_init(&cmp.differs, false);
+    const unsigned parts = axc__parts__(len, a->width);
+    axc__parallel__(parts, len, axc__diffPart__, &cmp);
+
+    uint64_t total = longer - len;
+    bool failed = false;
+    for (unsigned k = 0; k < parts; ++k) {
+        failed |= cmp.failed[k];
+        total += cmp.out[k] ? cmp.out[k]->len : 0;
+    }
+    const uint64_t oldLen = outIndices->len;
+    if (!failed && outIndices->len + total > outIndices->cap)
+        failed = axc_resize(outIndices, outIndices->len + total);
+    for (unsigned k = 0; k < parts; ++k) {
+        if (!failed)
+            failed = axc_write(outIndices, outIndices->len, cmp.out[k]->chunks, cmp.out[k]->len);
+        if (cmp.out[k])
+            axc_destroy(cmp.out[k]);
+    }
+    // chunks that exist in only one of the axchunks differ as well
+    for (uint64_t i = len; i < longer && !failed; ++i)
+        failed = axc_push(outIndices, &i);
+    if (failed)
+        axc_discard(outIndices, outIndices->len - oldLen);
+    return failed;
+}
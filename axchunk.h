@@ -46,6 +46,16 @@ typedef struct axchunk {
     void (*destroy)(void *);
     void (*resizeEventHandler)(struct axchunk *, ptrdiff_t, void *);
     void *resizeEventArgs;
+    uint64_t *dead;
+    uint64_t deadWords;
+    uint64_t deadLen;
+    double compactionThreshold;
+    uint64_t prefetchDistance;
+    struct axcmapping *mapping;
+    uint64_t *dirty;
+    uint64_t dirtyWords;
+    uint64_t dirtyShift;
+    struct axcjournal *journal;
 } axchunk;
 
 /**
@@ -79,6 +89,117 @@ static void *axc__quick_memmove__(void *dst, void *src, size_t n) {
     }
 }
 
+/**
+ * This is an internal function of the axchunk library.
+ * Whether the i-th chunk has a dead mark. The dead bitmap only covers the chunks up to the last one killed when it
+ * was last grown, so chunks beyond it are alive.
+ */
+static inline bool axc__isDead__(axchunk *c, uint64_t i) {
+    return i >> 6 < c->deadWords && c->dead[i >> 6] >> (i & 63) & 1;
+}
+
+/**
+ * This is an internal function of the axchunk library.
+ * Clears the dead mark of a chunk, if it has one.
+ */
+static inline void axc__revive__(axchunk *c, uint64_t i) {
+    if (axc__isDead__(c, i)) {
+        c->dead[i >> 6] &= ~((uint64_t) 1 << (i & 63));
+        --c->deadLen;
+    }
+}
+
+/**
+ * This is an internal function of the axchunk library.
+ * Allocates memory with the malloc function set by axc_memoryfn.
+ */
+void *axc__malloc__(size_t size);
+
+/**
+ * This is an internal function of the axchunk library.
+ * Reallocates memory with the realloc function set by axc_memoryfn.
+ */
+void *axc__realloc__(void *ptr, size_t size);
+
+/**
+ * This is an internal function of the axchunk library.
+ * Frees memory with the free function set by axc_memoryfn.
+ */
+void axc__free__(void *ptr);
+
+/**
+ * This is an internal function of the axchunk library.
+ * Marks the blocks of the chunks in [from, to) as dirty, if dirty tracking is enabled.
+ */
+static inline void axc__markDirty__(axchunk *c, uint64_t from, uint64_t to) {
+    if (!c->dirty || from >= to)
+        return;
+    for (uint64_t b = from >> c->dirtyShift; b <= (to - 1) >> c->dirtyShift; ++b)
+        c->dirty[b >> 6] |= (uint64_t) 1 << (b & 63);
+}
+
+/**
+ * This is an internal function of the axchunk library.
+ * Journals a push of the last chunk.
+ */
+void axc__journalPush__(axchunk *c);
+
+/**
+ * This is an internal function of the axchunk library.
+ * Journals a set of the i-th chunk.
+ */
+void axc__journalSet__(axchunk *c, uint64_t i);
+
+/**
+ * This is an internal function of the axchunk library.
+ * Journals the removal of the last n chunks.
+ */
+void axc__journalDiscard__(axchunk *c, uint64_t n);
+
+/**
+ * This is an internal function of the axchunk library.
+ * Journals a pop of the last chunk.
+ */
+void axc__journalPop__(axchunk *c);
+
+/**
+ * This is an internal function of the axchunk library.
+ * 64x64 to 128-bit multiplication folded back to 64 bits. Compilers without 128-bit integers multiply 32-bit halves
+ * instead, with the same result.
+ */
+static inline uint64_t axc__mum__(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t) a * b;
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+#else
+    const uint64_t lo = (a & 0xffffffff) * (b & 0xffffffff);
+    const uint64_t mid1 = (a >> 32) * (b & 0xffffffff);
+    const uint64_t mid2 = (a & 0xffffffff) * (b >> 32);
+    const uint64_t carry = ((lo >> 32) + (mid1 & 0xffffffff) + (mid2 & 0xffffffff)) >> 32;
+    return a * b ^ ((a >> 32) * (b >> 32) + (mid1 >> 32) + (mid2 >> 32) + carry);
+#endif
+}
+
+/**
+ * This is an internal function of the axchunk library.
+ * Fast non-cryptographic 64-bit hash of an arbitrary byte sequence.
+ */
+uint64_t axc__hash__(const void *data, size_t n, uint64_t seed);
+
+/**
+ * This is an internal function of the axchunk library.
+ * Packs the lowest bits of n values into a bit stream starting at some bit offset. The bits of the stream at and beyond
+ * the offset must be zero.
+ */
+void axc__packBits__(uint64_t *words, uint64_t bitOffset, const uint64_t *values, uint64_t n, uint64_t bits);
+
+/**
+ * This is an internal function of the axchunk library.
+ * Unpacks n values of some bit width from a bit stream starting at some bit offset. The stream must be followed by at
+ * least one word of padding, because values are loaded eight bytes at a time.
+ */
+void axc__unpackBits__(const uint64_t *words, uint64_t bitOffset, uint64_t *values, uint64_t n, uint64_t bits);
+
 /**
  * Set custom memory functions. All three of them must be set and be compatible with one another.
  * Passing NULL for any function will activate its standard library counterpart.
@@ -88,6 +209,29 @@ static void *axc__quick_memmove__(void *dst, void *src, size_t n) {
  */
 void axc_memoryfn(void *(*malloc_fn)(size_t), void *(*realloc_fn)(void *, size_t), void (*free_fn)(void *));
 
+/**
+ * Set the size from which bulk copies bypass the cache. Copies of at least this many bytes made by axc_copy,
+ * axc_internalCopy, axc_write and axc_read use non-temporal streaming stores, so that copying a huge axchunk does not
+ * evict the working set of other threads from the last level cache.
+ * @param bytes Threshold in bytes. Zero restores the default, which is the size of the last level cache.
+ */
+void axc_streamThreshold(size_t bytes);
+
+/**
+ * Set the number of threads used by parallel operations such as axc_reduce and axc_sum. Operations only go parallel
+ * for axchunks of at least a megabyte per thread, and the calling thread always does a share of the work.
+ * @param threads Maximum number of threads, at most 64. Zero restores the default, which is one thread per online
+ * processor. One disables parallel execution.
+ */
+void axc_threads(unsigned threads);
+
+/**
+ * Set whether asynchronous saves and loads may use io_uring. It is used by default where the kernel provides it, and
+ * jobs fall back to a pool of worker threads where it is unavailable or forbidden.
+ * @param enable False to always use worker threads.
+ */
+void axc_ioUring(bool enable);
+
 /**
  * Creates a new axchunk with default capacity.
  * @param width Size of individual chunks.
@@ -119,7 +263,7 @@ void *axc_destroySoft(axchunk *c);
 /**
  * Sets a new capacity for the axchunk.
  * @param size Number of chunks this axchunk should be able to hold at maximum.
- * @return True iff OOM.
+ * @return True iff OOM or, for a file-backed axchunk, the file could not be resized.
  */
 bool axc_resize(axchunk *c, uint64_t size);
 
@@ -245,7 +389,11 @@ static inline void *axc_getResizeEventArgs(axchunk *c) {
 static inline bool axc_push(axchunk *c, void *item) {
     if (c->len >= c->cap && axc_resize(c, (c->cap << 1) | 1))
         return true;
-    axc__quick_memcpy__(axc__index__(c, c->len++), item, c->width);
+    axc__quick_memcpy__(axc__index__(c, c->len), item, c->width);
+    axc__markDirty__(c, c->len, c->len + 1);
+    ++c->len;
+    if (c->journal)
+        axc__journalPush__(c);
     return false;
 }
 
@@ -256,8 +404,13 @@ static inline bool axc_push(axchunk *c, void *item) {
  * @return The destination pointer.
  */
 static inline void *axc_pop(axchunk *c, void *dest) {
-    if (c->len)
+    if (c->len) {
         axc__quick_memmove__(dest, axc__index__(c, --c->len), c->width);
+        if (c->deadLen)
+            axc__revive__(c, c->len);
+        if (c->journal)
+            axc__journalPop__(c);
+    }
     return dest;
 }
 
@@ -300,21 +453,184 @@ static inline bool axc_set(axchunk *c, uint64_t i, void *item) {
     if (i == c->len)
         return axc_push(c, item);
     axc__quick_memmove__(axc__index__(c, i), item, c->width);
+    axc__markDirty__(c, i, i + 1);
+    if (c->deadLen)
+        axc__revive__(c, i);
+    if (c->journal)
+        axc__journalSet__(c, i);
     return false;
 }
 
 /**
- * Swap the contents of two chunks. Does nothing if any index is out of range.
+ * Swap the contents of two chunks. Dead marks move with the chunks. Does nothing if any index is out of range or if
+ * the dead mark cannot be moved due to OOM.
  * @param i1 Index of one chunk.
  * @param i2 Index of another chunk.
  * @return Self.
  */
 axchunk *axc_swap(axchunk *c, uint64_t i1, uint64_t i2);
 
+/**
+ * Whether the chunk at some index has been marked dead by axc_kill.
+ * @param i Index of chunk.
+ * @return True iff the chunk exists and is dead.
+ */
+static inline bool axc_isDead(axchunk *c, uint64_t i) {
+    return i < c->len && axc__isDead__(c, i);
+}
+
+/**
+ * Number of chunks currently marked dead. These are still counted by axc_len until the axchunk is compacted.
+ * @return Number of dead chunks.
+ */
+static inline uint64_t axc_deadLen(axchunk *c) {
+    return c->deadLen;
+}
+
+/**
+ * Set the fraction of dead chunks at which axc_kill automatically compacts the axchunk. The default is 0.25.
+ * @param threshold Fraction of axc_len in [0, 1]. Zero compacts on every kill, one never compacts automatically.
+ * @return Self.
+ */
+static inline axchunk *axc_setCompactionThreshold(axchunk *c, double threshold) {
+    c->compactionThreshold = threshold;
+    return c;
+}
+
+/**
+ * Get the fraction of dead chunks at which axc_kill automatically compacts the axchunk.
+ * @return Compaction threshold.
+ */
+static inline double axc_getCompactionThreshold(axchunk *c) {
+    return c->compactionThreshold;
+}
+
+/**
+ * Set how many chunks ahead axc_foreach and axc_filter prefetch. This is worthwhile for wide chunks, where the
+ * hardware prefetcher cannot keep up with a per-chunk callback. The distance is also used as the prefetch distance of
+ * axc_gather and axc_scatter and as the batch size of axc_getMany. The default is zero, which disables prefetching in
+ * sequential scans.
+ * @param distance Number of chunks to prefetch ahead or zero.
+ * @return Self.
+ */
+static inline axchunk *axc_setPrefetchDistance(axchunk *c, uint64_t distance) {
+    c->prefetchDistance = distance;
+    return c;
+}
+
+/**
+ * Get how many chunks ahead sequential scans prefetch.
+ * @return Prefetch distance or zero if disabled.
+ */
+static inline uint64_t axc_getPrefetchDistance(axchunk *c) {
+    return c->prefetchDistance;
+}
+
+/**
+ * Lazily delete a chunk by marking it dead in a side bitmap. This is O(1) and does not move any chunk, so indices stay
+ * stable until the next compaction. Dead chunks are skipped by axc_foreach and removed by axc_filter and axc_compact;
+ * all other functions still treat them as occupied. Writing to a dead chunk with axc_set or axc_write revives it.
+ * The destructor is called on a dead chunk only once it is physically removed. If the fraction of dead chunks
+ * exceeds the compaction threshold, the axchunk is compacted before this function returns, which shifts indices.
+ * @param i Index of chunk to kill.
+ * @return True if index out of range or OOM.
+ */
+bool axc_kill(axchunk *c, uint64_t i);
+
+/**
+ * Remove all dead chunks and close the resulting gaps, preserving the relative order of the remaining chunks.
+ * If a destructor is set, it is called upon all removed chunks. O(n).
+ * @return Self.
+ */
+axchunk *axc_compact(axchunk *c);
+
+/**
+ * Enable, reconfigure or disable dirty tracking. While enabled, the axchunk is divided into blocks of blockLen
+ * consecutive chunks, and every function that changes chunks, including axc_push, axc_set, axc_write, axc_swap,
+ * axc_scatter and axc_filter, marks the blocks it changes as dirty. Compactions mark every block from the first
+ * removed chunk to the old end. Removing chunks from the end only changes the length, which is not tracked. Copies of
+ * an axchunk do not track. Changing the block length or enabling tracking clears all marks. Chunks changed through
+ * pointers, such as those returned by axc_index and axc_data, are not marked, so they are neither taken by
+ * axc_takeDirty nor written back by axc_syncDirty; mark their blocks by writing them with axc_set or axc_write.
+ * @param blockLen Number of chunks per block, rounded up to a power of two. Zero disables dirty tracking.
+ * @return True iff OOM, in which case nothing is done.
+ */
+bool axc_trackDirty(axchunk *c, uint64_t blockLen);
+
+/**
+ * Number of chunks per block of dirty tracking.
+ * @return Block length or zero if dirty tracking is disabled.
+ */
+static inline uint64_t axc_dirtyBlockLen(axchunk *c) {
+    return c->dirty ? (uint64_t) 1 << c->dirtyShift : 0;
+}
+
+/**
+ * Take the dirty blocks: push the indices of all blocks marked dirty since the last call, in ascending order, and
+ * clear their marks. Block b covers the chunks b * axc_dirtyBlockLen(c) to (b + 1) * axc_dirtyBlockLen(c) - 1.
+ * @param outBlocks Axchunk of width 8 to which the uint64_t block indices are pushed.
+ * @return True iff OOM, dirty tracking is disabled or outBlocks is not of width 8, in which case nothing is done.
+ */
+bool axc_takeDirty(axchunk *c, axchunk *outBlocks);
+
+/**
+ * Start journaling: from now on, every change to the chunks of the axchunk is appended as a compact record to a
+ * journal, which axc_replay can apply to a snapshot of the axchunk taken at this point, e.g. by axc_save. Pushes, sets,
+ * writes, removals from the end, swaps and kills are recorded with their arguments and chunks, and compactions such as
+ * axc_filter with a bitmap of the chunks they kept. Pops are recorded apart from other removals, since their chunk is
+ * handed to the caller: replaying a pop does not call the destructor, replaying any other removal does. Records are
+ * collected in a buffer. If a file descriptor is given, the buffer is written to it whenever it holds a batch of
+ * records, so that records reach the file in batches rather than one system call per change. Otherwise the buffer keeps
+ * growing until its records are consumed, see axc_journalBuffer. If the axchunk is already journaling, its journal is
+ * ended first.
+ * @param fd File descriptor to append the journal to, or a negative number to keep the journal in memory.
+ * @param batch Number of bytes to collect before writing them to the file descriptor. Zero uses 64 KiB.
+ * @return True iff OOM, in which case the axchunk does not journal.
+ */
+bool axc_journal(axchunk *c, int fd, uint64_t batch);
+
+/**
+ * Write all buffered records to the file descriptor of the journal. Does not sync the file. Records that could not be
+ * written stay buffered and are written by the next flush, so that the file never misses records in the middle.
+ * @return True iff journaling is disabled, writing the buffered records failed, or a record has been lost since
+ * journaling started because it could not be buffered.
+ */
+bool axc_journalFlush(axchunk *c);
+
+/**
+ * Buffer of the journal, an axchunk of width 1 holding the records not yet written to a file descriptor. The records
+ * of an in-memory journal may be consumed by reading them and then clearing the buffer.
+ * @return Buffer or NULL if journaling is disabled.
+ */
+axchunk *axc_journalBuffer(axchunk *c);
+
+/**
+ * Flush and end the journal. The file descriptor is not closed. Records that cannot be written are lost.
+ * @return True iff a record has been lost, see axc_journalFlush.
+ */
+bool axc_journalEnd(axchunk *c);
+
+/**
+ * Apply journal records to an axchunk, which must be in the state in which the journal was started. The changes are
+ * not journaled again, and no automatic compaction happens while replaying, since compactions are journaled
+ * themselves. An incomplete record at the end, as left by a crash in the middle of writing the journal, is ignored.
+ * @param records Records of a journal.
+ * @param size Size of the records in bytes.
+ * @return True iff OOM or a record does not fit the axchunk, in which case the records before it have been applied.
+ */
+bool axc_replay(axchunk *c, const void *records, uint64_t size);
+
+/**
+ * Same as axc_replay, but reads the records from a file descriptor up to its end.
+ * @param fd File descriptor to read the journal from, at its current offset.
+ * @return True iff OOM, a read failed or a record does not fit the axchunk.
+ */
+bool axc_replayFd(axchunk *c, int fd);
+
 /**
  * Let f be a function taking (pointer to chunk, optional argument).
  * Call f(x, arg) on each chunk x until f returns false or all chunks of the axchunk have been exhausted.
- * Chunks are iterated from first to last.
+ * Chunks are iterated from first to last. Dead chunks are skipped; f must not kill chunks while iterating.
  * @param f Function to call on all chunks.
  * @param arg An optional argument passed to the function.
  * @return Self.
@@ -326,13 +642,30 @@ axchunk *axc_foreach(axchunk *c, bool (*f)(void *, void *), void *arg);
  * Keep all chunks x in the axchunk that satisfy f(x, arg), remove all those that don't, and close the resulting
  * gaps by contracting the space between all remaining chunks, thus preserving the relative order of the remaining
  * chunks. If a destructor is set, it is called upon all removed chunks. The filter is applied linearly from first
- * to last chunk. O(n).
+ * to last chunk. Dead chunks are removed without being passed to f. O(n).
  * @param f Some predicate to filter the axchunk.
  * @param arg An optional argument passed to the filter.
  * @return Self.
  */
 axchunk *axc_filter(axchunk *c, bool (*f)(const void *, void *), void *arg);
 
+/**
+ * Remove all chunks that are equal to their predecessor, so that a sorted axchunk keeps only one chunk of every value.
+ * Chunks are compared byte by byte, and the remaining chunks are compacted as in axc_filter. If a destructor is set,
+ * it is called upon all removed chunks. Dead chunks are removed. O(n).
+ * @return Self.
+ */
+axchunk *axc_unique(axchunk *c);
+
+/**
+ * Remove all chunks that are equal to an earlier chunk, keeping the first of every value. Unlike axc_unique, this
+ * does not need the axchunk to be sorted: the chunks seen so far are tracked in a temporary hash set. Chunks are
+ * compared byte by byte, and the remaining chunks are compacted as in axc_filter. If a destructor is set, it is called
+ * upon all removed chunks. Dead chunks are removed. O(n).
+ * @return Self or NULL iff OOM, in which case nothing is done.
+ */
+axchunk *axc_dedupHashed(axchunk *c);
+
 /**
  * Remove every chunk in this axchunk and set its length to zero. If a destructor is set, it is called upon
  * each chunk.
@@ -382,5 +715,519 @@ bool axc_write(axchunk *c, uint64_t i, void *chunks, uint64_t chkcount);
  */
 uint64_t axc_read(axchunk *c, uint64_t i, void *chunks, uint64_t chkcount);
 
+/**
+ * Copy the chunks at the given indices into a contiguous buffer, in the order of the index list. Chunk loads are
+ * prefetched several indices ahead, so this is much faster than a loop of axc_get on an axchunk that does not fit
+ * in cache. Indices out of range are skipped and leave their slot in the buffer untouched.
+ * @param indices Indices of the chunks to copy.
+ * @param n Number of indices.
+ * @param dst Chunk destination large enough to hold n chunks.
+ * @return Number of chunks copied. Equals n iff all indices were in range.
+ */
+uint64_t axc_gather(axchunk *src, const uint64_t *indices, uint64_t n, void *dst);
+
+/**
+ * Overwrite the chunks at the given indices with consecutive chunks from a buffer. The k-th chunk of the buffer is
+ * copied to the chunk at indices[k]. Chunk stores are prefetched several indices ahead. Indices out of range are
+ * skipped; this function never grows the axchunk. Overwritten dead chunks are revived. If a destructor is set, it is
+ * called upon every chunk right before it is overwritten.
+ * @param indices Indices of the chunks to overwrite.
+ * @param n Number of indices.
+ * @param src Chunk source holding n chunks.
+ * @return Number of chunks copied. Equals n iff all indices were in range.
+ */
+uint64_t axc_scatter(axchunk *dst, const uint64_t *indices, uint64_t n, void *src);
+
+/**
+ * Batched random access. The indices are processed in batches whose size is the prefetch distance of the axchunk,
+ * or a default if none is set: all chunks of a batch are prefetched first and then copied, so their cache misses
+ * overlap. Indices out of range are skipped and leave their slot in the buffer untouched, just like with axc_get.
+ * @param indices Indices of the chunks to copy.
+ * @param n Number of indices.
+ * @param dest Chunk destination large enough to hold n chunks.
+ * @return The destination pointer.
+ */
+void *axc_getMany(axchunk *c, const uint64_t *indices, uint64_t n, void *dest);
+
+/**
+ * Byte-shuffle n chunks of some width into byte planes: first byte 0 of every chunk, then byte 1 of every chunk, and so
+ * on. Numeric records compress much better this way, because bytes of equal significance end up next to each other.
+ * Widths of 2, 4, 8 and 16 bytes use SIMD kernels.
+ * @param src Chunk source.
+ * @param dst Destination of n * width bytes. Must not overlap the source.
+ * @param n Number of chunks.
+ * @param width Size of individual chunks.
+ */
+void axc_shuffleBytes(const void *src, void *dst, uint64_t n, uint64_t width);
+
+/**
+ * Inverse of axc_shuffleBytes: interleave n * width bytes of byte planes back into n chunks.
+ * @param src Byte planes.
+ * @param dst Chunk destination of n * width bytes. Must not overlap the source.
+ * @param n Number of chunks.
+ * @param width Size of individual chunks.
+ */
+void axc_unshuffleBytes(const void *src, void *dst, uint64_t n, uint64_t width);
+
+/**
+ * Byte-shuffle the occupied chunks of an axchunk into a buffer, see axc_shuffleBytes.
+ * @param dst Destination of axc_len * axc_width bytes.
+ * @return The destination pointer.
+ */
+void *axc_shuffle(axchunk *c, void *dst);
+
+/**
+ * Like axc_write, but the chunks to write are given as byte planes as produced by axc_shuffle.
+ * @param i Index at which to start overwriting chunks.
+ * @param src Byte planes of chkcount chunks.
+ * @param chkcount Number of chunks to write.
+ * @return True iff OOM.
+ */
+bool axc_unshuffle(axchunk *c, uint64_t i, const void *src, uint64_t chkcount);
+
+/*
+ * On-disk format of an axchunk, as written by axc_save. All integers are stored in host byte order.
+ *
+ *   offset  size  field
+ *        0     8  magic, the bytes "AXCHUNK" followed by a zero byte
+ *        8     4  version of the format, currently 1
+ *       12     4  flags; bit 0 is set if the chunk checksum is not maintained and zero
+ *       16     8  width of a chunk in bytes
+ *       24     8  number of chunks
+ *       32     8  alignment, i.e. the byte offset of the chunk array; a multiple of 4096
+ *       40     8  checksum of the chunk array (axc__hash__ with seed zero), see flags
+ *       48     8  checksum of the bytes 0 to 47 (axc__hash__ with seed zero)
+ *       56     -  zero padding up to the alignment
+ *  alignment     width * number of chunks bytes of raw chunks
+ *
+ * Files are written with an alignment of 4096 bytes or the page size, whichever is larger, so the chunk array starts
+ * on a page boundary and can be mapped into memory as is. Since files are mapped from offset zero, an alignment that is
+ * smaller than the page size is accepted too, and a file can be loaded on a machine with larger pages than the one
+ * that wrote it. The file may be longer than the chunk array; file-backed axchunks keep their spare capacity at the end
+ * of the file.
+ */
+
+/**
+ * Save the occupied chunks of an axchunk to a file descriptor in the on-disk format. The file is written from offset
+ * zero with pwrite, whatever the current position of the descriptor, which is left unchanged. Anything the file held
+ * beyond the saved chunks is kept, so truncate it first if it may be longer. Dead marks are not saved; compact the
+ * axchunk first if it has dead chunks.
+ * @param fd File descriptor of a regular file open for writing.
+ * @return True iff an I/O error occurred, in which case errno is set.
+ */
+bool axc_save(axchunk *c, int fd);
+
+/**
+ * Load an axchunk saved by axc_save without deserialising it. The file is mapped copy-on-write and the chunks of the
+ * returned axchunk point directly into the mapping, so loading costs no more than reading the header; pages are
+ * read from disk as they are touched. Modifying chunks never changes the file. The first resize moves the chunks
+ * into heap memory obtained from the memory functions. Only the header checksum is verified, since verifying the chunk
+ * checksum would read the whole file; call axc_verify for that.
+ * @param path Path of the file.
+ * @return New axchunk or NULL iff an I/O error occurred, the file is malformed or OOM.
+ */
+axchunk *axc_mmapLoad(const char *path);
+
+/**
+ * Verify the chunks of an axchunk loaded by axc_mmapLoad against the chunk checksum in its file. This reads every
+ * chunk, so all of the file is read from disk. Verify before changing the axchunk, since any change makes the
+ * chunks differ from the file.
+ * @return True iff the chunks do not match the checksum, or there is nothing to verify against: the file has no chunk
+ * checksum, or the axchunk is not mapped by axc_mmapLoad, as after a resize or for a file without chunks.
+ */
+bool axc_verify(axchunk *c);
+
+/**
+ * Open or create a file-backed axchunk, whose internal array lives in a shared mapping of a file in the on-disk format.
+ * Every change to a chunk goes straight to the file, so the axchunk survives restarts without being saved. Resizing
+ * grows or shrinks the file and remaps it, which may move the chunks and fires the resize event handler as usual.
+ * The length is recorded in the file by axc_sync, axc_syncRange and when the axchunk is destroyed. The chunk checksum
+ * is not maintained for file-backed axchunks.
+ * If the file exists and is not empty, it is opened and its chunks are kept. Otherwise it is created.
+ * @param path Path of the file.
+ * @param width Size of individual chunks. If the file exists, this must match its width, unless it is zero.
+ * @param size Number of chunks to allocate when the file is created.
+ * @return New axchunk or NULL iff an I/O error occurred, the file is malformed or OOM.
+ */
+axchunk *axc_newFileBacked(const char *path, uint64_t width, uint64_t size);
+
+/**
+ * Flush a file-backed axchunk to disk: record its length in the file and write back every modified page of the
+ * occupied chunks. Does nothing for any other axchunk.
+ * @return True iff an I/O error occurred.
+ */
+bool axc_sync(axchunk *c);
+
+/**
+ * Like axc_sync, but if dirty tracking is enabled, only the pages of the dirty blocks are written back, and their
+ * marks are cleared once they have been. These are the same marks that axc_takeDirty takes, so use either of them,
+ * and note that chunks changed through pointers are not marked; see axc_trackDirty. If dirty tracking is disabled,
+ * this is the same as axc_sync.
+ * @return True iff an I/O error occurred.
+ */
+bool axc_syncDirty(axchunk *c);
+
+/**
+ * Like axc_sync, but only the pages of a range of chunks are written back, in addition to the length. Use this if
+ * you know which chunks have been modified.
+ * @param i Index of the first chunk to write back.
+ * @param n Number of chunks to write back. This is automatically clamped to the chunks occupied.
+ * @return True iff an I/O error occurred.
+ */
+bool axc_syncRange(axchunk *c, uint64_t i, uint64_t n);
+
+/*
+ * An axcjob is a handle to an asynchronous save or load. The chunk array is split into large page-aligned extents
+ * which are written or read in parallel: by a single worker thread submitting them to an io_uring, or where that is
+ * unavailable by a number of worker threads with pwrite and pread, see axc_ioUring. Whole pages of page-aligned chunk
+ * memory bypass the page cache with O_DIRECT where the file system supports it. Every job must be finished with
+ * axc_wait, which also releases it.
+ */
+typedef struct axcjob axcjob;
+
+/**
+ * Save an axchunk asynchronously to a file in the on-disk format. The file is created or truncated. The axchunk must
+ * be neither modified nor resized until the job has finished. Since the chunks are written in parallel, no chunk
+ * checksum is computed and the file is flagged accordingly.
+ * @param path Path of the file.
+ * @param threads Number of extents transferred at once, which is the number of worker threads without io_uring. Zero
+ * selects a default.
+ * @param done Optional function called by a worker thread once the job has finished, taking the job, zero or the errno
+ * of the first failure and the optional argument. It must not call axc_wait.
+ * @param arg An optional argument passed to the completion function.
+ * @return Job or NULL iff the file could not be created, the threads could not be started or OOM.
+ */
+axcjob *axc_saveAsync(axchunk *c, const char *path, unsigned threads,
+                      void (*done)(axcjob *, int, void *), void *arg);
+
+/**
+ * Load an axchunk asynchronously from a file in the on-disk format into heap memory. The loaded axchunk is obtained
+ * from axc_wait. Unless custom memory functions are set, its chunks are page-aligned, so that they can be read with
+ * O_DIRECT.
+ * @param path Path of the file.
+ * @param threads Number of extents transferred at once, which is the number of worker threads without io_uring. Zero
+ * selects a default.
+ * @param done Optional function called by a worker thread once the job has finished, taking the job, zero or the errno
+ * of the first failure and the optional argument. It must not call axc_wait.
+ * @param arg An optional argument passed to the completion function.
+ * @return Job or NULL iff the file could not be opened or is malformed, the threads could not be started or OOM.
+ */
+axcjob *axc_loadAsync(const char *path, unsigned threads, void (*done)(axcjob *, int, void *), void *arg);
+
+/**
+ * Whether an asynchronous job has finished. This never blocks.
+ * @return True iff the job has finished.
+ */
+bool axc_poll(axcjob *job);
+
+/**
+ * Wait for an asynchronous job to finish and release it.
+ * @param loaded For load jobs, receives the loaded axchunk, or NULL if the job failed. May be NULL for save jobs.
+ * @return Zero or the errno of the first failure.
+ */
+int axc_wait(axcjob *job, axchunk **loaded);
+
+/*
+ * An axcview is a lightweight, non-owning view of a range of chunks of an axchunk, optionally with a stride. A view
+ * is a plain value and never copies any chunk. It refers to its chunks by index rather than by address, so it stays
+ * valid across resizes of its axchunk without a resize event handler having to rebase it. If the axchunk shrinks,
+ * chunks of the view that are no longer occupied simply become out of range.
+ */
+typedef struct axcview {
+    axchunk *base;
+    uint64_t offset;
+    uint64_t len;
+    uint64_t stride;
+} axcview;
+
+/**
+ * Create a view of consecutive chunks of an axchunk.
+ * @param offset Index of the first chunk of the view.
+ * @param len Number of chunks of the view. This is automatically clamped to the chunks occupied.
+ * @return View of the axchunk.
+ */
+static inline axcview axc_view(axchunk *c, uint64_t offset, uint64_t len) {
+    uint64_t avail = offset < c->len ? c->len - offset : 0;
+    return (axcview) {c, offset, len < avail ? len : avail, 1};
+}
+
+/**
+ * Create a view of every stride-th chunk of an axchunk.
+ * @param offset Index of the first chunk of the view.
+ * @param len Number of chunks of the view. This is automatically clamped to the chunks occupied.
+ * @param stride Distance between two chunks of the view, in chunks. Zero is treated as one.
+ * @return View of the axchunk.
+ */
+static inline axcview axc_viewStrided(axchunk *c, uint64_t offset, uint64_t len, uint64_t stride) {
+    stride += !stride;
+    uint64_t avail = offset < c->len ? (c->len - offset - 1) / stride + 1 : 0;
+    return (axcview) {c, offset, len < avail ? len : avail, stride};
+}
+
+/**
+ * Number of chunks of a view that are still occupied in its axchunk.
+ * @return Length of view.
+ */
+static inline uint64_t axcv_len(axcview v) {
+    uint64_t len = v.base->len;
+    uint64_t avail = v.offset < len ? (len - v.offset - 1) / v.stride + 1 : 0;
+    return v.len < avail ? v.len : avail;
+}
+
+/**
+ * Get a pointer to the chunk at some index of a view.
+ * @param i Index of chunk relative to the view.
+ * @return Pointer to chunk or NULL if index out of range of the view or its axchunk.
+ */
+static inline void *axcv_index(axcview v, uint64_t i) {
+    return i < axcv_len(v) ? axc__index__(v.base, v.offset + i * v.stride) : NULL;
+}
+
+/**
+ * Read an arbitrary amount of chunks from a view at some index. If the requested chunks are out of range, less than
+ * the specified amount of chunks will be copied.
+ * @param i Index relative to the view at which to start copying chunks.
+ * @param chunks Chunk destination.
+ * @param chkcount Number of chunks to copy.
+ * @return The actual amount of chunks read.
+ */
+uint64_t axcv_read(axcview v, uint64_t i, void *chunks, uint64_t chkcount);
+
+/**
+ * Let f be a function taking (pointer to chunk, optional argument).
+ * Call f(x, arg) on each chunk x of the view until f returns false or all chunks of the view have been exhausted.
+ * Dead chunks are skipped.
+ * @param f Function to call on all chunks.
+ * @param arg An optional argument passed to the function.
+ * @return The view.
+ */
+axcview axcv_foreach(axcview v, bool (*f)(void *, void *), void *arg);
+
+/**
+ * Let f be a predicate taking (pointer to chunk, optional argument).
+ * Copy all chunks x of the view that satisfy f(x, arg) into a new axchunk, preserving their order. Dead chunks are
+ * skipped. The viewed axchunk is left untouched, and no destructor is set on the new axchunk.
+ * @param f Some predicate to filter the view.
+ * @param arg An optional argument passed to the filter.
+ * @return New axchunk or NULL iff OOM.
+ */
+axchunk *axcv_filter(axcview v, bool (*f)(const void *, void *), void *arg);
+
+/*
+ * Numeric type of a field of a chunk. Fields are read in the byte order of the machine and need not be aligned.
+ */
+typedef enum axctype {
+    AXC_I8, AXC_I16, AXC_I32, AXC_I64,
+    AXC_U8, AXC_U16, AXC_U32, AXC_U64,
+    AXC_F32, AXC_F64,
+} axctype;
+
+/*
+ * Result of a numeric operation on fields of some axctype: i for signed, u for unsigned and f for floating-point types.
+ */
+typedef union axcnum {
+    int64_t i;
+    uint64_t u;
+    double f;
+} axcnum;
+
+/**
+ * Size of a field of some type.
+ * @return Size in bytes.
+ */
+static inline uint64_t axc_typeSize(axctype type) {
+    switch (type) {
+    case AXC_I8: case AXC_U8: return 1;
+    case AXC_I16: case AXC_U16: return 2;
+    case AXC_I32: case AXC_U32: case AXC_F32: return 4;
+    default: return 8;
+    }
+}
+
+/**
+ * Let identity be a function taking (pointer to accumulator, optional argument), fold a function taking
+ * (pointer to accumulator, pointer to chunk, optional argument) and combine a function taking
+ * (pointer to accumulator, pointer to other accumulator, optional argument).
+ * Reduce all live chunks to a single accumulator. The axchunk is split into consecutive parts, each of which gets an
+ * accumulator initialised by identity and folds its chunks into it in order. The accumulators of the parts are then
+ * combined into acc from first to last, so fold and combine need to be associative, but not commutative.
+ * @param acc Accumulator receiving the result. It is initialised by identity.
+ * @param accWidth Size of an accumulator in bytes.
+ * @param identity Function initialising an accumulator.
+ * @param fold Function folding a chunk into an accumulator.
+ * @param combine Function combining another accumulator into an accumulator, or NULL to reduce sequentially.
+ * @param arg An optional argument passed to all three functions.
+ * @return The accumulator.
+ */
+void *axc_reduce(axchunk *c, void *acc, uint64_t accWidth, void (*identity)(void *, void *),
+                 void (*fold)(void *, const void *, void *), void (*combine)(void *, const void *, void *), void *arg);
+
+/**
+ * Sum of a numeric field over all live chunks. Integers are summed modulo 2^64, floating-point numbers in double
+ * precision and in no particular order.
+ * @param offset Byte offset of the field within a chunk.
+ * @param type Type of the field.
+ * @return Sum or zero if the field does not fit into a chunk.
+ */
+axcnum axc_sum(axchunk *c, uint64_t offset, axctype type);
+
+/**
+ * Minimum of a numeric field over all live chunks. NaNs are ignored unless there is nothing else.
+ * @param offset Byte offset of the field within a chunk.
+ * @param type Type of the field.
+ * @return Minimum or zero if there are no live chunks or the field does not fit into a chunk.
+ */
+axcnum axc_min(axchunk *c, uint64_t offset, axctype type);
+
+/**
+ * Maximum of a numeric field over all live chunks. NaNs are ignored unless there is nothing else.
+ * @param offset Byte offset of the field within a chunk.
+ * @param type Type of the field.
+ * @return Maximum or zero if there are no live chunks or the field does not fit into a chunk.
+ */
+axcnum axc_max(axchunk *c, uint64_t offset, axctype type);
+
+/**
+ * Number of live chunks whose numeric field is not zero.
+ * @param offset Byte offset of the field within a chunk.
+ * @param type Type of the field.
+ * @return Count or zero if the field does not fit into a chunk.
+ */
+uint64_t axc_count(axchunk *c, uint64_t offset, axctype type);
+
+/**
+ * Prefix sums of a numeric field. The i-th sum covers the fields of chunks 0 to i (inclusive) or 0 to i - 1
+ * (exclusive). Dead chunks count as zero. Sums are computed as in axc_sum and converted back to the type of the field.
+ * Large axchunks are scanned in parallel parts, but unlike axc_sum, each part is scanned by a scalar loop: every sum
+ * depends on the one before it, so there is no SIMD kernel for the scan itself.
+ * @param offset Byte offset of the field within a chunk.
+ * @param type Type of the field.
+ * @param exclusive Whether the i-th sum excludes the field of chunk i.
+ * @param dst Destination of one value of the type per chunk, or NULL to overwrite the fields in place.
+ * @return True iff the field does not fit into a chunk, in which case nothing is done.
+ */
+bool axc_prefixSum(axchunk *c, uint64_t offset, axctype type, bool exclusive, void *dst);
+
+/**
+ * Let f be a function taking (pointer to source chunks, pointer to destination chunks, number of chunks,
+ * optional argument).
+ * Transform all live chunks into a new axchunk of another width, preserving their order. The new axchunk is allocated
+ * once with exactly the capacity needed, and f is called on runs of consecutive chunks rather than on single chunks, so
+ * it can transform a whole run in one loop. f must write as many destination chunks as it is given source chunks.
+ * @param dstWidth Width of the chunks of the new axchunk.
+ * @param f Function transforming a run of chunks.
+ * @param arg An optional argument passed to the function.
+ * @return New axchunk or NULL iff OOM.
+ */
+axchunk *axc_map(axchunk *src, uint64_t dstWidth, void (*f)(const void *, void *, uint64_t, void *), void *arg);
+
+/**
+ * Same as axc_map, but large axchunks are split into parts that are transformed by concurrent threads, see
+ * axc_threads. f must be safe to call from several threads at once.
+ */
+axchunk *axc_mapParallel(axchunk *src, uint64_t dstWidth, void (*f)(const void *, void *, uint64_t, void *),
+                         void *arg);
+
+/*
+ * Aggregate function of axc_groupBy.
+ */
+typedef enum axcagg {
+    AXC_AGG_SUM,
+    AXC_AGG_MIN,
+    AXC_AGG_MAX,
+    AXC_AGG_COUNT,
+} axcagg;
+
+/*
+ * Aggregate computed by axc_groupBy: an aggregate function over a numeric field given by its byte offset and type.
+ * The field is ignored by AXC_AGG_COUNT, which counts the chunks of a group.
+ */
+typedef struct axcaggregate {
+    axcagg fn;
+    uint64_t offset;
+    axctype type;
+} axcaggregate;
+
+/**
+ * Group all live chunks by a key and compute aggregates for every group. Keys are compared byte by byte. Each result
+ * chunk consists of the key of a group followed by one axcnum per aggregate, in the order of the aggregates, computed as
+ * in axc_sum, axc_min and axc_max. The groups are in no particular order. Large axchunks are radix partitioned by the
+ * hash of their keys first, so that every partition is aggregated in a hash table that fits into the cache, and the
+ * partitions are spread over several threads, see axc_threads.
+ * @param keyOffset Byte offset of the key within a chunk.
+ * @param keyWidth Size of the key in bytes.
+ * @param aggs Aggregates to compute.
+ * @param naggs Number of aggregates.
+ * @return New axchunk of width keyWidth + naggs * sizeof(axcnum), or NULL iff OOM or a field does not fit into a chunk.
+ */
+axchunk *axc_groupBy(axchunk *c, uint64_t keyOffset, uint64_t keyWidth, const axcaggregate *aggs, uint64_t naggs);
+
+/**
+ * Join two axchunks on equal keys. A hash table is built from the live chunks of the left axchunk and probed with the
+ * live chunks of the right one, and every matching pair of chunks is emitted into the result, in no particular order.
+ * Keys are compared byte by byte. If the left axchunk is too large for its table to fit into the cache, both axchunks
+ * are radix partitioned by the hash of their keys first and every partition is joined on its own. Partitions, or
+ * ranges of the right axchunk, are spread over several threads, see axc_threads.
+ * @param left Axchunk to build the hash table from, preferably the smaller one.
+ * @param leftKeyOffset Byte offset of the key within a chunk of the left axchunk.
+ * @param right Axchunk to probe the hash table with.
+ * @param rightKeyOffset Byte offset of the key within a chunk of the right axchunk.
+ * @param keyWidth Size of the key in bytes.
+ * @param indices Whether to emit pairs of uint64_t indices (left, right) instead of the left chunk immediately followed
+ * by the right chunk.
+ * @return New axchunk of the matches or NULL iff OOM or a key does not fit into a chunk.
+ */
+axchunk *axc_hashJoin(axchunk *left, uint64_t leftKeyOffset, axchunk *right, uint64_t rightKeyOffset,
+                      uint64_t keyWidth, bool indices);
+
+/**
+ * Fast non-cryptographic 64-bit hash of a chunk, suitable for hash tables. Chunks of 1, 2, 4, 8 and 16 bytes are
+ * hashed with a couple of multiplications; other widths fall back to a general hash over the bytes.
+ * @param chunk Pointer to chunk.
+ * @param width Size of the chunk in bytes.
+ * @param seed Seed of the hash.
+ * @return Hash of the chunk.
+ */
+static inline uint64_t axc_hash(const void *chunk, uint64_t width, uint64_t seed) {
+    uint64_t a = 0, b = 0;
+    switch (width) {
+    case 1: a = *(const uint8_t *) chunk; break;
+    case 2: memcpy(&a, chunk, 2); break;
+    case 4: memcpy(&a, chunk, 4); break;
+    case 8: memcpy(&a, chunk, 8); break;
+    case 16: memcpy(&a, chunk, 8); memcpy(&b, (const char *) chunk + 8, 8); break;
+    default: return axc__hash__(chunk, width, seed);
+    }
+    uint64_t h = axc__mum__(a ^ 0xa0761d6478bd642full, b ^ seed ^ 0xe7037ed1a0b428dbull);
+    return axc__mum__(h ^ 0x8ebc6af09c88c6e3ull, width ^ 0xe7037ed1a0b428dbull);
+}
+
+/**
+ * Fingerprint of the occupied chunks of an axchunk for cheap change detection, e.g. between two copies made by
+ * axc_copy. The chunks are hashed in blocks, which are spread over several threads for large axchunks, see
+ * axc_threads. The fingerprint depends on the width, the length and the bytes of all chunks, but not on dead marks or
+ * the number of threads.
+ * @return 64-bit fingerprint.
+ */
+uint64_t axc_fingerprint(axchunk *c);
+
+/**
+ * Whether two axchunks have the same width, the same length and byte for byte equal chunks. Dead marks are ignored.
+ * Large axchunks are compared in blocks with SIMD and on several threads, see axc_threads.
+ * @return True iff the axchunks are equal.
+ */
+bool axc_equal(axchunk *a, axchunk *b);
+
+/**
+ * Find the indices of all chunks that differ between two axchunks of the same width, e.g. two snapshots made by
+ * axc_copy. A chunk differs if its bytes are not equal in both axchunks or if it is only occupied in one of them.
+ * Blocks of chunks are compared with SIMD first, and only the chunks of differing blocks are compared one by one.
+ * Large axchunks are compared on several threads, see axc_threads. Dead marks are ignored.
+ * @param outIndices Axchunk of width 8 to which the uint64_t indices of the differing chunks are pushed in ascending
+ * order.
+ * @return True iff OOM or the widths do not match, in which case no index is pushed.
+ */
+bool axc_diff(axchunk *a, axchunk *b, axchunk *outIndices);
+
 #undef axc__index__
 #endif //AXCHUNK_AXCHUNK_H
@@ -0,0 +1,174 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axcolumns.h"
+
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+
+axcolumns *axcol_new(const uint64_t *widths, uint64_t ncolumns) {
+    return axcol_newSized(widths, ncolumns, 7);
+}
+
+axcolumns *axcol_newSized(const uint64_t *widths, uint64_t ncolumns, uint64_t size) {
+    if (!ncolumns)
+        return NULL;
+    axcolumns *t = axc__malloc__(sizeof *t);
+    if (!t)
+        return NULL;
+    t->columns = axc__malloc__(ncolumns * sizeof *t->columns);
+    t->offsets = axc__malloc__(ncolumns * sizeof *t->offsets);
+    t->ncolumns = 0;
+    t->width = 0;
+    if (!t->columns || !t->offsets) {
+        axcol_destroy(t);
+        return NULL;
+    }
+    for (; t->ncolumns < ncolumns; ++t->ncolumns) {
+        axchunk *column = axc_newSized(widths[t->ncolumns], size);
+        if (!column) {
+            axcol_destroy(t);
+            return NULL;
+        }
+        t->columns[t->ncolumns] = column;
+        t->offsets[t->ncolumns] = t->width;
+        t->width += column->width;
+    }
+    return t;
+}
+
+void axcol_destroy(axcolumns *t) {
+    for (uint64_t k = 0; k < t->ncolumns; ++k)
+        axc_destroy(t->columns[k]);
+    axc__free__(t->columns);
+    axc__free__(t->offsets);
+    axc__free__(t);
+}
+
+bool axcol_resize(axcolumns *t, uint64_t size) {
+    const uint64_t cap = axcol_ucap(t);
+    for (uint64_t k = 0; k < t->ncolumns; ++k) {
+        if (axc_resize(t->columns[k], size)) {
+            while (k--)
+                axc_resize(t->columns[k], cap);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Makes sure every column can hold at least size records, growing geometrically.
+ */
+static bool axcol__reserve__(axcolumns *t, uint64_t size) {
+    uint64_t cap = axcol_ucap(t);
+    if (size <= cap)
+        return false;
+    return axcol_resize(t, MAX((cap << 1) | 1, size));
+}
+
+/**
+ * Unpacks count records into the columns starting at index i, one column at a time.
+ */
+static void axcol__unpack__(axcolumns *t, uint64_t i, const char *records, uint64_t count) {
+    for (uint64_t k = 0; k < t->ncolumns; ++k) {
+        axchunk *column = t->columns[k];
+        const uint64_t width = column->width;
+        const char *src = records + t->offsets[k];
+        char *dst = (char *) column->chunks + i * width;
+        for (uint64_t r = 0; r < count; ++r) {
+            axc__quick_memcpy__(dst, (void *) src, width);
+            src += t->width;
+            dst += width;
+        }
+    }
+}
+
+/**
+ * Packs count records starting at index i from the columns into a buffer, one column at a time.
+ */
+static void axcol__pack__(axcolumns *t, uint64_t i, char *records, uint64_t count) {
+    for (uint64_t k = 0; k < t->ncolumns; ++k) {
+        axchunk *column = t->columns[k];
+        const uint64_t width = column->width;
+        const char *src = (char *) column->chunks + i * width;
+        char *dst = records + t->offsets[k];
+        for (uint64_t r = 0; r < count; ++r) {
+            axc__quick_memcpy__(dst, (void *) src, width);
+            src += width;
+            dst += t->width;
+        }
+    }
+}
+
+static void axcol__setLen__(axcolumns *t, uint64_t len) {
+    for (uint64_t k = 0; k < t->ncolumns; ++k)
+        t->columns[k]->len = len;
+}
+
+bool axcol_push(axcolumns *t, const void *record) {
+    uint64_t len = axcol_ulen(t);
+    if (axcol__reserve__(t, len + 1))
+        return true;
+    axcol__unpack__(t, len, record, 1);
+    axcol__setLen__(t, len + 1);
+    return false;
+}
+
+void *axcol_pop(axcolumns *t, void *dest) {
+    uint64_t len = axcol_ulen(t);
+    if (len) {
+        axcol__pack__(t, len - 1, dest, 1);
+        axcol__setLen__(t, len - 1);
+    }
+    return dest;
+}
+
+void *axcol_get(axcolumns *t, uint64_t i, void *dest) {
+    if (i < axcol_ulen(t))
+        axcol__pack__(t, i, dest, 1);
+    return dest;
+}
+
+bool axcol_set(axcolumns *t, uint64_t i, const void *record) {
+    uint64_t len = axcol_ulen(t);
+    if (i > len)
+        return true;
+    if (i == len)
+        return axcol_push(t, record);
+    axcol__unpack__(t, i, record, 1);
+    return false;
+}
+
+bool axcol_write(axcolumns *t, uint64_t i, const void *records, uint64_t count) {
+    uint64_t len = axcol_ulen(t);
+    if (i > len || axcol__reserve__(t, i + count))
+        return true;
+    axcol__unpack__(t, i, records, count);
+    axcol__setLen__(t, MAX(i + count, len));
+    return false;
+}
+
+uint64_t axcol_read(axcolumns *t, uint64_t i, void *records, uint64_t count) {
+    uint64_t len = axcol_ulen(t);
+    if (i >= len)
+        return 0;
+    count = MIN(count, len - i);
+    axcol__pack__(t, i, records, count);
+    return count;
+}
+
+axcolumns *axcol_clear(axcolumns *t) {
+    for (uint64_t k = 0; k < t->ncolumns; ++k)
+        axc_clear(t->columns[k]);
+    return t;
+}
+
+axcolumns *axcol_discard(axcolumns *t, uint64_t n) {
+    for (uint64_t k = 0; k < t->ncolumns; ++k)
+        axc_discard(t->columns[k], n);
+    return t;
+}
@@ -0,0 +1,208 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXCHUNK_AXCOLUMNS_H
+#define AXCHUNK_AXCOLUMNS_H
+
+#include "axchunk.h"
+
+/*
+ * axcolumns is the columnar (structure-of-arrays) counterpart of axchunk.
+ *
+ * It is created from a schema of field widths. A record is the concatenation of all its fields, so its width is the
+ * sum of the field widths. Instead of storing whole records next to each other, axcolumns stores each field in its
+ * own axchunk, so that a scan over a single field only touches the memory of that field.
+ *
+ * The record-wise functions pack and unpack whole records, so they mirror the axchunk interface. The columns
+ * themselves can be accessed directly by pointer or as an axchunk.
+ *
+ * The struct definition of axcolumns is given in its header for optimisation purposes only. To use axcolumns, you must
+ * rely solely on the functions of the library.
+ */
+typedef struct axcolumns {
+    axchunk **columns;
+    uint64_t *offsets;
+    uint64_t ncolumns;
+    uint64_t width;
+} axcolumns;
+
+/**
+ * Creates a new axcolumns with default capacity.
+ * @param widths Width of each field in a record.
+ * @param ncolumns Number of fields.
+ * @return New axcolumns or NULL iff OOM or ncolumns is zero.
+ */
+axcolumns *axcol_new(const uint64_t *widths, uint64_t ncolumns);
+
+/**
+ * Creates a new axcolumns with given capacity.
+ * @param widths Width of each field in a record.
+ * @param ncolumns Number of fields.
+ * @param size Number of records to allocate.
+ * @return New axcolumns or NULL iff OOM or ncolumns is zero.
+ */
+axcolumns *axcol_newSized(const uint64_t *widths, uint64_t ncolumns, uint64_t size);
+
+/**
+ * Destroys the axcolumns and all of its columns.
+ */
+void axcol_destroy(axcolumns *t);
+
+/**
+ * Sets a new capacity for every column.
+ * @param size Number of records this axcolumns should be able to hold at maximum.
+ * @return True iff OOM, in which case the columns resized already are resized back to the old capacity.
+ */
+bool axcol_resize(axcolumns *t, uint64_t size);
+
+/**
+ * Unsigned number of occupied records.
+ * @return Unsigned length of axcolumns.
+ */
+static inline uint64_t axcol_ulen(axcolumns *t) {
+    return t->columns[0]->len;
+}
+
+/**
+ * Signed number of occupied records.
+ * @return Signed length of axcolumns.
+ */
+static inline int64_t axcol_len(axcolumns *t) {
+    return (int64_t) t->columns[0]->len;
+}
+
+/**
+ * Unsigned maximum number of records that can be held without resizing. This is the smallest capacity of all
+ * columns, which differ only if a failed axcol_resize could not resize some columns back.
+ * @return Unsigned capacity of axcolumns.
+ */
+static inline uint64_t axcol_ucap(axcolumns *t) {
+    uint64_t cap = t->columns[0]->cap;
+    for (uint64_t k = 1; k < t->ncolumns; ++k)
+        cap = t->columns[k]->cap < cap ? t->columns[k]->cap : cap;
+    return cap;
+}
+
+/**
+ * Size of a whole record, i.e. the sum of all field widths.
+ * @return Record width.
+ */
+static inline uint64_t axcol_width(axcolumns *t) {
+    return t->width;
+}
+
+/**
+ * Number of fields in a record.
+ * @return Number of columns.
+ */
+static inline uint64_t axcol_ncolumns(axcolumns *t) {
+    return t->ncolumns;
+}
+
+/**
+ * Width of a single field.
+ * @param k Index of column.
+ * @return Field width.
+ */
+static inline uint64_t axcol_columnWidth(axcolumns *t, uint64_t k) {
+    return t->columns[k]->width;
+}
+
+/**
+ * Byte offset of a field inside a packed record.
+ * @param k Index of column.
+ * @return Field offset.
+ */
+static inline uint64_t axcol_columnOffset(axcolumns *t, uint64_t k) {
+    return t->offsets[k];
+}
+
+/**
+ * Pointer to the contiguous array of a field. This pointer is invalidated by any function that resizes the
+ * axcolumns.
+ * @param k Index of column.
+ * @return Internal array of the column.
+ */
+static inline void *axcol_column(axcolumns *t, uint64_t k) {
+    return t->columns[k]->chunks;
+}
+
+/**
+ * The axchunk backing a field, for use with the axchunk library. Its chunks may be modified freely, but its length
+ * must not be changed, or the axcolumns will be left in an inconsistent state.
+ * @param k Index of column.
+ * @return Column axchunk.
+ */
+static inline axchunk *axcol_axchunk(axcolumns *t, uint64_t k) {
+    return t->columns[k];
+}
+
+/**
+ * Push a record to the end of the axcolumns, unpacking it into its columns. This operation may resize the axcolumns.
+ * @param record Pointer to record of record-width size.
+ * @return True iff OOM, in which case nothing is pushed.
+ */
+bool axcol_push(axcolumns *t, const void *record);
+
+/**
+ * Pop the last record off the end of the axcolumns and pack it into dest. Nothing is done in the case there
+ * currently are no records occupied.
+ * @param dest Pointer to buffer where the record will be written into.
+ * @return The destination pointer.
+ */
+void *axcol_pop(axcolumns *t, void *dest);
+
+/**
+ * Get the i-th record and pack it into the memory buffer dest. Does nothing when index is out of range.
+ * @param i Index of record to copy.
+ * @param dest Pointer to buffer where the record will be written into.
+ * @return The destination pointer.
+ */
+void *axcol_get(axcolumns *t, uint64_t i, void *dest);
+
+/**
+ * Set the i-th record. If i is equal to the length, the record is simply pushed. If i points to an occupied record,
+ * that record is overwritten. Otherwise the function fails and does nothing.
+ * @param i Index of record to overwrite.
+ * @param record Record to unpack into the columns.
+ * @return True if index out of range or OOM.
+ */
+bool axcol_set(axcolumns *t, uint64_t i, const void *record);
+
+/**
+ * Write an arbitrary amount of packed records into the axcolumns at some index. If the requested records to be
+ * overwritten don't exist, the axcolumns is resized appropriately.
+ * @param i Index at which to start overwriting records.
+ * @param records Record source.
+ * @param count Number of records to copy.
+ * @return True if i is past the end or OOM, in which case nothing is written.
+ */
+bool axcol_write(axcolumns *t, uint64_t i, const void *records, uint64_t count);
+
+/**
+ * Read an arbitrary amount of records at some index and pack them into a buffer. If the requested records are
+ * unoccupied or don't exist, less than the specified amount of records will be copied.
+ * @param i Index at which to start copying records.
+ * @param records Record destination.
+ * @param count Number of records to copy.
+ * @return The actual amount of records read.
+ */
+uint64_t axcol_read(axcolumns *t, uint64_t i, void *records, uint64_t count);
+
+/**
+ * Remove every record and set the length to zero.
+ * @return Self.
+ */
+axcolumns *axcol_clear(axcolumns *t);
+
+/**
+ * Remove the last n records.
+ * @param n Number of records to discard. This is automatically clamped to the number of records occupied.
+ * @return Self.
+ */
+axcolumns *axcol_discard(axcolumns *t, uint64_t n);
+
+#endif //AXCHUNK_AXCOLUMNS_H
@@ -0,0 +1,342 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axcpack.h"
+
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+#define MAX(x,y) ((x) > (y) ? (x) : (y))
+
+enum {
+    AXP_BLOCK_LEN = 4096,
+    AXP_CACHE_BLOCKS = 8,
+    AXP_RUN_MIN = 3,
+    AXP_RUN_MAX = 130,
+    AXP_LITERAL_MAX = 128,
+};
+
+/**
+ * A block is hot if its data holds the raw chunks, and cold if it holds them compressed.
+ */
+struct axpblock {
+    char *data;
+    uint64_t size;
+    bool cold;
+    bool accessed;
+};
+
+static inline uint64_t axp__blockBytes__(axcpack *p) {
+    return p->blockLen * p->width;
+}
+
+/**
+ * Number of chunks in a block. Only the last block may be incomplete.
+ */
+static inline uint64_t axp__blockChunks__(axcpack *p, uint64_t block) {
+    return MIN(p->blockLen, p->len - block * p->blockLen);
+}
+
+/**
+ * Upper bound of the size of run-length encoded data.
+ */
+static inline uint64_t axp__rleBound__(uint64_t n) {
+    return n + n / AXP_LITERAL_MAX + 1;
+}
+
+/**
+ * Run-length encoding. A control byte c < 128 is followed by c + 1 literal bytes, a control byte c >= 128 is followed
+ * by a single byte that is repeated c - 128 + AXP_RUN_MIN times.
+ */
+static uint64_t axp__rleEncode__(const uint8_t *in, uint64_t n, uint8_t *out) {
+    uint64_t o = 0;
+    uint64_t literal = 0;
+    uint64_t i = 0;
+    while (i <= n) {
+        uint64_t run = 0;
+        if (i < n) {
+            run = 1;
+            while (i + run < n && run < AXP_RUN_MAX && in[i + run] == in[i])
+                ++run;
+        }
+        if (run >= AXP_RUN_MIN || i == n) {
+            while (literal < i) {
+                uint64_t k = MIN((uint64_t) AXP_LITERAL_MAX, i - literal);
+                out[o++] = (uint8_t) (k - 1);
+                memcpy(out + o, in + literal, k);
+                o += k;
+                literal += k;
+            }
+            if (i == n)
+                break;
+            out[o++] = (uint8_t) (128 + run - AXP_RUN_MIN);
+            out[o++] = in[i];
+            literal = i + run;
+        }
+        i += run;
+    }
+    return o;
+}
+
+static void axp__rleDecode__(const uint8_t *in, uint64_t n, uint8_t *out) {
+    const uint8_t *end = in + n;
+    while (in < end) {
+        uint8_t control = *in++;
+        if (control < 128) {
+            memcpy(out, in, control + 1u);
+            in += control + 1u;
+            out += control + 1u;
+        } else {
+            memset(out, *in++, control - 128u + AXP_RUN_MIN);
+            out += control - 128u + AXP_RUN_MIN;
+        }
+    }
+}
+
+axcpack *axp_new(axchunk *c, uint64_t blockLen, uint64_t cacheBlocks) {
+    axcpack *p = axc__malloc__(sizeof *p);
+    if (!p)
+        return NULL;
+    p->blockLen = blockLen ? blockLen : AXP_BLOCK_LEN;
+    p->cacheSlots = cacheBlocks ? cacheBlocks : AXP_CACHE_BLOCKS;
+    p->width = c->width;
+    p->len = 0;
+    p->nblocks = 0;
+    p->cacheHand = 0;
+    const uint64_t blockBytes = axp__blockBytes__(p);
+    const uint64_t nblocks = (c->len + p->blockLen - 1) / p->blockLen;
+    p->blocks = axc__malloc__(MAX(nblocks, 1) * sizeof *p->blocks);
+    p->cache = axc__malloc__(p->cacheSlots * blockBytes);
+    p->cachedBlock = axc__malloc__(p->cacheSlots * sizeof *p->cachedBlock);
+    p->cacheRef = axc__malloc__(p->cacheSlots * sizeof *p->cacheRef);
+    p->scratch = axc__malloc__(blockBytes + axp__rleBound__(blockBytes));
+    if (!p->blocks || !p->cache || !p->cachedBlock || !p->cacheRef || !p->scratch) {
+        axp_destroy(p);
+        return NULL;
+    }
+    for (uint64_t k = 0; k < p->cacheSlots; ++k) {
+        p->cachedBlock[k] = -1;
+        p->cacheRef[k] = false;
+    }
+    for (; p->nblocks < nblocks; ++p->nblocks) {
+        struct axpblock *block = &p->blocks[p->nblocks];
+        block->data = axc__malloc__(blockBytes);
+        if (!block->data) {
+            axp_destroy(p);
+            return NULL;
+        }
+        uint64_t first = p->nblocks * p->blockLen;
+        uint64_t n = MIN(p->blockLen, c->len - first);
+        memcpy(block->data, (char *) c->chunks + first * c->width, n * c->width);
+        block->size = blockBytes;
+        block->cold = false;
+        block->accessed = false;
+    }
+    p->len = c->len;
+    return p;
+}
+
+void axp_destroy(axcpack *p) {
+    if (p->blocks) {
+        for (uint64_t k = 0; k < p->nblocks; ++k)
+            axc__free__(p->blocks[k].data);
+    }
+    axc__free__(p->blocks);
+    axc__free__(p->cache);
+    axc__free__(p->cachedBlock);
+    axc__free__(p->cacheRef);
+    axc__free__(p->scratch);
+    axc__free__(p);
+}
+
+/**
+ * Removes a block from the cache, if it is cached.
+ */
+static void axp__uncache__(axcpack *p, uint64_t block) {
+    for (uint64_t k = 0; k < p->cacheSlots; ++k) {
+        if (p->cachedBlock[k] == (int64_t) block)
+            p->cachedBlock[k] = -1;
+    }
+}
+
+/**
+ * Decompresses a cold block into the given buffer.
+ */
+static void axp__decompress__(axcpack *p, uint64_t block, char *out) {
+    struct axpblock *b = &p->blocks[block];
+    uint64_t n = axp__blockChunks__(p, block);
+    axp__rleDecode__((uint8_t *) b->data, b->size, (uint8_t *) p->scratch);
+    axc_unshuffleBytes(p->scratch, out, n, p->width);
+}
+
+/**
+ * Raw chunks of a block. Cold blocks are looked up in the cache, or decompressed into a slot chosen by the clock
+ * algorithm.
+ */
+static char *axp__blockData__(axcpack *p, uint64_t block) {
+    struct axpblock *b = &p->blocks[block];
+    b->accessed = true;
+    if (!b->cold)
+        return b->data;
+    const uint64_t blockBytes = axp__blockBytes__(p);
+    for (uint64_t k = 0; k < p->cacheSlots; ++k) {
+        if (p->cachedBlock[k] == (int64_t) block) {
+            p->cacheRef[k] = true;
+            return p->cache + k * blockBytes;
+        }
+    }
+    while (p->cacheRef[p->cacheHand]) {
+        p->cacheRef[p->cacheHand] = false;
+        p->cacheHand = (p->cacheHand + 1) % p->cacheSlots;
+    }
+    uint64_t slot = p->cacheHand;
+    p->cacheHand = (p->cacheHand + 1) % p->cacheSlots;
+    char *data = p->cache + slot * blockBytes;
+    axp__decompress__(p, block, data);
+    p->cachedBlock[slot] = (int64_t) block;
+    p->cacheRef[slot] = true;
+    return data;
+}
+
+/**
+ * Turns a cold block back into a hot one. Returns true iff OOM.
+ */
+static bool axp__thaw__(axcpack *p, uint64_t block) {
+    struct axpblock *b = &p->blocks[block];
+    if (!b->cold)
+        return false;
+    char *data = axc__malloc__(axp__blockBytes__(p));
+    if (!data)
+        return true;
+    axp__decompress__(p, block, data);
+    axp__uncache__(p, block);
+    axc__free__(b->data);
+    b->data = data;
+    b->size = axp__blockBytes__(p);
+    b->cold = false;
+    return false;
+}
+
+const void *axp_index(axcpack *p, uint64_t i) {
+    if (i >= p->len)
+        return NULL;
+    return axp__blockData__(p, i / p->blockLen) + i % p->blockLen * p->width;
+}
+
+void *axp_get(axcpack *p, uint64_t i, void *dest) {
+    if (i < p->len)
+        axc__quick_memcpy__(dest, (void *) axp_index(p, i), p->width);
+    return dest;
+}
+
+uint64_t axp_read(axcpack *p, uint64_t i, void *chunks, uint64_t chkcount) {
+    if (i >= p->len)
+        return 0;
+    chkcount = MIN(chkcount, p->len - i);
+    char *out = chunks;
+    for (uint64_t left = chkcount; left;) {
+        uint64_t block = i / p->blockLen;
+        uint64_t offset = i % p->blockLen;
+        uint64_t n = MIN(left, p->blockLen - offset);
+        struct axpblock *b = &p->blocks[block];
+        if (b->cold && offset == 0 && n == axp__blockChunks__(p, block)) {
+            // whole cold blocks are decompressed straight into the destination without going through the cache
+            b->accessed = true;
+            axp__decompress__(p, block, out);
+        } else {
+            memcpy(out, axp__blockData__(p, block) + offset * p->width, n * p->width);
+        }
+        out += n * p->width;
+        i += n;
+        left -= n;
+    }
+    return chkcount;
+}
+
+bool axp_set(axcpack *p, uint64_t i, const void *item) {
+    if (i >= p->len)
+        return true;
+    uint64_t block = i / p->blockLen;
+    if (axp__thaw__(p, block))
+        return true;
+    p->blocks[block].accessed = true;
+    axc__quick_memcpy__(p->blocks[block].data + i % p->blockLen * p->width, (void *) item, p->width);
+    return false;
+}
+
+bool axp_push(axcpack *p, const void *item) {
+    uint64_t block = p->len / p->blockLen;
+    if (block == p->nblocks) {
+        struct axpblock *blocks = axc__realloc__(p->blocks, (p->nblocks + 1) * sizeof *blocks);
+        if (!blocks)
+            return true;
+        p->blocks = blocks;
+        char *data = axc__malloc__(axp__blockBytes__(p));
+        if (!data)
+            return true;
+        blocks[block] = (struct axpblock) {data, axp__blockBytes__(p), false, false};
+        ++p->nblocks;
+    } else if (axp__thaw__(p, block)) {
+        return true;
+    }
+    p->blocks[block].accessed = true;
+    axc__quick_memcpy__(p->blocks[block].data + p->len % p->blockLen * p->width, (void *) item, p->width);
+    ++p->len;
+    return false;
+}
+
+bool axp_compress(axcpack *p, uint64_t block) {
+    if (block >= p->nblocks)
+        return false;
+    struct axpblock *b = &p->blocks[block];
+    if (b->cold)
+        return true;
+    const uint64_t n = axp__blockChunks__(p, block);
+    const uint64_t bytes = n * p->width;
+    uint8_t *shuffled = (uint8_t *) p->scratch;
+    uint8_t *encoded = shuffled + axp__blockBytes__(p);
+    axc_shuffleBytes(b->data, shuffled, n, p->width);
+    uint64_t size = axp__rleEncode__(shuffled, bytes, encoded);
+    if (size >= bytes)
+        return false;
+    char *data = axc__malloc__(size);
+    if (!data)
+        return false;
+    memcpy(data, encoded, size);
+    axc__free__(b->data);
+    b->data = data;
+    b->size = size;
+    b->cold = true;
+    return true;
+}
+
+uint64_t axp_compressCold(axcpack *p) {
+    uint64_t compressed = 0;
+    for (uint64_t k = 0; k < p->nblocks; ++k) {
+        struct axpblock *b = &p->blocks[k];
+        if (!b->cold && !b->accessed)
+            compressed += axp_compress(p, k);
+        b->accessed = false;
+    }
+    return compressed;
+}
+
+bool axp_isCold(axcpack *p, uint64_t block) {
+    return block < p->nblocks && p->blocks[block].cold;
+}
+
+uint64_t axp_storageSize(axcpack *p) {
+    uint64_t size = 0;
+    for (uint64_t k = 0; k < p->nblocks; ++k)
+        size += p->blocks[k].size;
+    return size;
+}
+
+axchunk *axp_toAxchunk(axcpack *p) {
+    axchunk *c = axc_newSized(p->width, p->len);
+    if (!c)
+        return NULL;
+    c->len = axp_read(p, 0, c->chunks, p->len);
+    return c;
+}
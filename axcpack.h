@@ -0,0 +1,153 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXCHUNK_AXCPACK_H
+#define AXCHUNK_AXCPACK_H
+
+#include "axchunk.h"
+
+/*
+ * axcpack is a block-compressed store of fixed-width chunks for data that is mostly cold.
+ *
+ * The chunks are split into blocks of a fixed number of chunks. A block is either hot, i.e. stored as is, or cold,
+ * i.e. compressed with a built-in codec: the bytes of the block are byte-shuffled, so that byte k of every chunk is
+ * stored next to byte k of all other chunks, and the result is run-length encoded. Fixed-width numeric records
+ * compress well this way, because their high bytes rarely change.
+ *
+ * Chunks of cold blocks are decompressed lazily on access into a small cache of decompressed blocks. Pointers returned
+ * by axp_index into a cold block are therefore only valid until the next access of another cold block.
+ *
+ * Blocks become cold through axp_compressCold, which compresses every hot block that has not been accessed since its
+ * previous call, or through axp_compress. Modifying a chunk of a cold block makes that block hot again.
+ *
+ * The struct definition of axcpack is given in its header for optimisation purposes only. To use axcpack, you must
+ * rely solely on the functions of the library.
+ */
+typedef struct axcpack {
+    struct axpblock *blocks;
+    uint64_t nblocks;
+    uint64_t blockLen;
+    uint64_t width;
+    uint64_t len;
+    char *cache;
+    int64_t *cachedBlock;
+    bool *cacheRef;
+    uint64_t cacheSlots;
+    uint64_t cacheHand;
+    char *scratch;
+} axcpack;
+
+/**
+ * Creates a new axcpack holding a copy of the occupied chunks of an axchunk. All blocks start out hot.
+ * @param blockLen Number of chunks per block. Zero selects a default.
+ * @param cacheBlocks Number of decompressed blocks to cache. Zero selects a default.
+ * @return New axcpack or NULL iff OOM.
+ */
+axcpack *axp_new(axchunk *c, uint64_t blockLen, uint64_t cacheBlocks);
+
+/**
+ * Destroys the axcpack.
+ */
+void axp_destroy(axcpack *p);
+
+/**
+ * Unsigned number of chunks.
+ * @return Unsigned length of axcpack.
+ */
+static inline uint64_t axp_ulen(axcpack *p) {
+    return p->len;
+}
+
+/**
+ * Size of each individual chunk.
+ * @return Chunk width of an axcpack.
+ */
+static inline uint64_t axp_width(axcpack *p) {
+    return p->width;
+}
+
+/**
+ * Number of blocks.
+ * @return Number of blocks of an axcpack.
+ */
+static inline uint64_t axp_nblocks(axcpack *p) {
+    return p->nblocks;
+}
+
+/**
+ * Get a pointer to the chunk at some index. If its block is cold, it is decompressed into the cache first. The pointer
+ * is invalidated by the next access of any other cold block and by any function that modifies the axcpack.
+ * @param i Index of chunk.
+ * @return Pointer to chunk or NULL if index out of range or OOM.
+ */
+const void *axp_index(axcpack *p, uint64_t i);
+
+/**
+ * Get the i-th chunk and copy it into the memory buffer dest. Does nothing when index is out of range.
+ * @param i Index of chunk to copy.
+ * @param dest Pointer to buffer where the chunk will be written into.
+ * @return The destination pointer.
+ */
+void *axp_get(axcpack *p, uint64_t i, void *dest);
+
+/**
+ * Read an arbitrary amount of chunks at some index. If the requested chunks don't exist, less than the specified
+ * amount of chunks will be copied.
+ * @param i Index at which to start copying chunks.
+ * @param chunks Chunk destination.
+ * @param chkcount Number of chunks to copy.
+ * @return The actual amount of chunks read.
+ */
+uint64_t axp_read(axcpack *p, uint64_t i, void *chunks, uint64_t chkcount);
+
+/**
+ * Overwrite the i-th chunk. If its block is cold, the block is made hot first.
+ * @param i Index of chunk to overwrite.
+ * @param item Item to copy into the chunk.
+ * @return True if index out of range or OOM.
+ */
+bool axp_set(axcpack *p, uint64_t i, const void *item);
+
+/**
+ * Push a chunk to the end of the axcpack. The last block is made hot if necessary.
+ * @param item Pointer to item of chunk-width size.
+ * @return True iff OOM.
+ */
+bool axp_push(axcpack *p, const void *item);
+
+/**
+ * Compress a block. Blocks that do not shrink are kept hot.
+ * @param block Index of block.
+ * @return True iff the block is cold afterwards.
+ */
+bool axp_compress(axcpack *p, uint64_t block);
+
+/**
+ * Compress every hot block that has not been accessed since the previous call of this function.
+ * @return Number of blocks compressed.
+ */
+uint64_t axp_compressCold(axcpack *p);
+
+/**
+ * Whether a block is compressed.
+ * @param block Index of block.
+ * @return True iff the block is cold.
+ */
+bool axp_isCold(axcpack *p, uint64_t block);
+
+/**
+ * Total number of bytes used to store the chunks of all blocks, hot or cold.
+ * @return Storage size in bytes.
+ */
+uint64_t axp_storageSize(axcpack *p);
+
+/**
+ * Decompress all chunks into a new axchunk.
+ * @return New axchunk or NULL iff OOM.
+ */
+axchunk *axp_toAxchunk(axcpack *p);
+
+#endif //AXCHUNK_AXCPACK_H
@@ -0,0 +1,225 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axcstream.h"
+#include <errno.h>
+#include <sys/uio.h>
+
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+
+/**
+ * writev(2) that retries until everything has been written. The iovecs are consumed in the process.
+ * Returns zero or the errno of the failed write.
+ */
+static int axcs__writev__(int fd, struct iovec *iov, int iovcnt) {
+    while (iovcnt) {
+        ssize_t written = writev(fd, iov, iovcnt);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        while (iovcnt && (size_t) written >= iov->iov_len) {
+            written -= (ssize_t) iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt) {
+            iov->iov_base = (char *) iov->iov_base + written;
+            iov->iov_len -= (size_t) written;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Writes out the chunks of a buffer and empties it.
+ */
+static int axcs__drain__(int fd, axchunk *buffer) {
+    struct iovec iov = {buffer->chunks, buffer->len * buffer->width};
+    axc_clear(buffer);
+    return iov.iov_len ? axcs__writev__(fd, &iov, 1) : 0;
+}
+
+static void *axcs__flusher__(void *arg) {
+    axcstream *s = arg;
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        while (!s->pending && !s->closing)
+            pthread_cond_wait(&s->cond, &s->lock);
+        if (!s->pending)
+            break;
+        // once a write has failed, later batches are dropped rather than written after the gap
+        axchunk *buffer = s->flushing;
+        const bool failed = s->error;
+        pthread_mutex_unlock(&s->lock);
+        int error = 0;
+        if (failed)
+            axc_clear(buffer);
+        else
+            error = axcs__drain__(s->fd, buffer);
+        pthread_mutex_lock(&s->lock);
+        if (error && !s->error)
+            s->error = error;
+        s->pending = false;
+        pthread_cond_broadcast(&s->cond);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+axcstream *axcs_new(int fd, uint64_t width, uint64_t batch, bool async) {
+    batch += !batch;
+    axcstream *s = axc__malloc__(sizeof *s);
+    if (!s)
+        return NULL;
+    s->filling = axc_newSized(width, batch);
+    s->flushing = async ? axc_newSized(width, batch) : NULL;
+    s->batch = batch;
+    s->fd = fd;
+    s->error = 0;
+    s->failed = false;
+    s->async = async;
+    s->pending = false;
+    s->closing = false;
+    if (!s->filling || (async && !s->flushing))
+        goto fail;
+    if (async) {
+        if (pthread_mutex_init(&s->lock, NULL))
+            goto fail;
+        if (pthread_cond_init(&s->cond, NULL)) {
+            pthread_mutex_destroy(&s->lock);
+            goto fail;
+        }
+        if (pthread_create(&s->thread, NULL, axcs__flusher__, s)) {
+            pthread_cond_destroy(&s->cond);
+            pthread_mutex_destroy(&s->lock);
+            goto fail;
+        }
+    }
+    return s;
+
+fail:
+    if (s->filling)
+        axc_destroy(s->filling);
+    if (s->flushing)
+        axc_destroy(s->flushing);
+    axc__free__(s);
+    return NULL;
+}
+
+/**
+ * Waits until the background thread is idle. Must be called with the lock held.
+ */
+static void axcs__await__(axcstream *s) {
+    while (s->pending)
+        pthread_cond_wait(&s->cond, &s->lock);
+}
+
+/**
+ * Writes out the buffer that is being filled. In asynchronous mode, the buffers are swapped and the full one is
+ * handed to the background thread. Once a failure has been seen, the producer stops buffering chunks.
+ */
+static bool axcs__submit__(axcstream *s) {
+    if (!s->async) {
+        if (!s->error)
+            s->error = axcs__drain__(s->fd, s->filling);
+        s->failed = s->error;
+        return s->failed;
+    }
+    pthread_mutex_lock(&s->lock);
+    axcs__await__(s);
+    axchunk *full = s->filling;
+    s->filling = s->flushing;
+    s->flushing = full;
+    s->pending = true;
+    pthread_cond_broadcast(&s->cond);
+    s->failed = s->error;
+    pthread_mutex_unlock(&s->lock);
+    return s->failed;
+}
+
+int axcs_error(axcstream *s) {
+    if (!s->async)
+        return s->error;
+    pthread_mutex_lock(&s->lock);
+    int error = s->error;
+    pthread_mutex_unlock(&s->lock);
+    return error;
+}
+
+bool axcs_push(axcstream *s, void *item) {
+    if (s->failed || axc_push(s->filling, item))
+        return true;
+    return s->filling->len >= s->batch ? axcs__submit__(s) : false;
+}
+
+bool axcs_write(axcstream *s, void *chunks, uint64_t chkcount) {
+    if (s->failed)
+        return true;
+    axchunk *filling = s->filling;
+    uint64_t room = s->batch - filling->len;
+    if (chkcount < room + s->batch) {
+        // the chunks fill at most one batch, so buffer them
+        uint64_t first = MIN(chkcount, room);
+        if (axc_write(filling, filling->len, chunks, first))
+            return true;
+        if (filling->len >= s->batch && axcs__submit__(s))
+            return true;
+        if (chkcount > first)
+            return axc_write(s->filling, s->filling->len, (char *) chunks + first * filling->width, chkcount - first);
+        return false;
+    }
+    // write the buffered chunks and all whole batches of the source at once, then buffer the remainder
+    uint64_t direct = chkcount - (chkcount - room) % s->batch;
+    struct iovec iov[2] = {
+        {filling->chunks, filling->len * filling->width},
+        {chunks, direct * filling->width},
+    };
+    if (s->async) {
+        pthread_mutex_lock(&s->lock);
+        axcs__await__(s);
+    }
+    int error = s->error ? s->error : axcs__writev__(s->fd, iov, 2);
+    if (error && !s->error)
+        s->error = error;
+    if (s->async)
+        pthread_mutex_unlock(&s->lock);
+    s->failed = error;
+    if (error)
+        return true;
+    axc_clear(filling);
+    return axc_write(filling, 0, (char *) chunks + direct * filling->width, chkcount - direct);
+}
+
+bool axcs_flush(axcstream *s) {
+    if (!s->async)
+        return s->filling->len ? axcs__submit__(s) : s->error;
+    if (s->filling->len)
+        axcs__submit__(s);
+    pthread_mutex_lock(&s->lock);
+    axcs__await__(s);
+    bool failed = s->error;
+    pthread_mutex_unlock(&s->lock);
+    return failed;
+}
+
+bool axcs_destroy(axcstream *s) {
+    bool failed = axcs_flush(s);
+    if (s->async) {
+        pthread_mutex_lock(&s->lock);
+        s->closing = true;
+        pthread_cond_broadcast(&s->cond);
+        pthread_mutex_unlock(&s->lock);
+        pthread_join(s->thread, NULL);
+        pthread_cond_destroy(&s->cond);
+        pthread_mutex_destroy(&s->lock);
+        axc_destroy(s->flushing);
+    }
+    axc_destroy(s->filling);
+    axc__free__(s);
+    return failed;
+}
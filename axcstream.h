@@ -0,0 +1,94 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXCHUNK_AXCSTREAM_H
+#define AXCHUNK_AXCSTREAM_H
+
+#include "axchunk.h"
+#include <pthread.h>
+
+/*
+ * axcstream is an append-only writer of fixed-width chunks to a file descriptor.
+ *
+ * Chunks are accumulated in an internal axchunk and written out in batches with writev. In asynchronous mode, the
+ * stream has two buffers and a background thread: while the thread writes out one full buffer, the producer keeps
+ * filling the other one, so the producer only ever blocks if it outpaces the file descriptor.
+ *
+ * The chunks are written as raw chunks without any header. Write errors are sticky: once a write has failed, every
+ * later call fails as well without buffering any more chunks, and axcs_error tells the errno of the failed write.
+ *
+ * The struct definition of axcstream is given in its header for optimisation purposes only. To use axcstream, you must
+ * rely solely on the functions of the library.
+ */
+typedef struct axcstream {
+    axchunk *filling;
+    axchunk *flushing;
+    uint64_t batch;
+    int fd;
+    int error;
+    bool failed;
+    bool async;
+    bool pending;
+    bool closing;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} axcstream;
+
+/**
+ * Creates a new stream writer.
+ * @param fd File descriptor open for writing. It is not closed by the stream.
+ * @param width Size of individual chunks.
+ * @param batch Number of chunks that are written out at once.
+ * @param async Whether to double buffer and write out full batches on a background thread.
+ * @return New stream or NULL iff OOM or the thread could not be started.
+ */
+axcstream *axcs_new(int fd, uint64_t width, uint64_t batch, bool async);
+
+/**
+ * Write out all buffered chunks, stop the background thread and destroy the stream.
+ * @return True iff a write failed at any point during the lifetime of the stream.
+ */
+bool axcs_destroy(axcstream *s);
+
+/**
+ * Append a chunk to the stream. If this fills the current batch, the batch is written out; in asynchronous mode this
+ * only blocks if the previous batch is still being written.
+ * @param item Pointer to item of chunk-width size.
+ * @return True iff OOM or a write has failed, in which case the chunk has not been appended.
+ */
+bool axcs_push(axcstream *s, void *item);
+
+/**
+ * Append an arbitrary amount of chunks to the stream. Chunks that make up whole batches are written straight from
+ * the source together with the buffered chunks in a single writev, without being copied into the buffer.
+ * @param chunks Chunk source.
+ * @param chkcount Number of chunks to append.
+ * @return True iff OOM or a write has failed, in which case some of the chunks may have been appended.
+ */
+bool axcs_write(axcstream *s, void *chunks, uint64_t chkcount);
+
+/**
+ * Write out all buffered chunks, including an incomplete batch, and wait until they have been written.
+ * @return True iff a write has failed.
+ */
+bool axcs_flush(axcstream *s);
+
+/**
+ * Number of chunks currently held in the buffer that is being filled.
+ * @return Number of buffered chunks.
+ */
+static inline uint64_t axcs_buffered(axcstream *s) {
+    return s->filling->len;
+}
+
+/**
+ * The errno of the first failed write, or zero if every write succeeded so far.
+ * @return Error code.
+ */
+int axcs_error(axcstream *s);
+
+#endif //AXCHUNK_AXCSTREAM_H
@@ -0,0 +1,140 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axintern.h"
+
+enum {
+    AXI_TABLE_SIZE = 64,
+};
+
+/**
+ * Entry of a string: where it starts in the arena, its size and the low half of its hash.
+ */
+struct axientry {
+    uint64_t offset;
+    uint32_t len;
+    uint32_t hash;
+};
+
+static inline uint32_t axi__hash__(const void *data, uint64_t size) {
+    return (uint32_t) axc__hash__(data, size, 0);
+}
+
+/**
+ * Slot of the table holding the string or, if it is not interned, the empty slot where it belongs. Slots hold an ID
+ * plus one, so that zero marks an empty slot.
+ */
+static uint64_t axi__probe__(axintern *p, const void *data, uint64_t size, uint32_t hash) {
+    const struct axientry *entries = p->entries->chunks;
+    const char *arena = p->arena->chunks;
+    for (uint64_t slot = hash & p->mask;; slot = (slot + 1) & p->mask) {
+        uint32_t id = p->table[slot];
+        if (!id)
+            return slot;
+        const struct axientry *e = &entries[id - 1];
+        if (e->hash == hash && e->len == size && !memcmp(arena + e->offset, data, size))
+            return slot;
+    }
+}
+
+/**
+ * Doubles the number of slots and reinserts all IDs from their stored hashes.
+ */
+static bool axi__grow__(axintern *p) {
+    const uint64_t slots = (p->mask + 1) << 1;
+    uint32_t *table = axc__malloc__(slots * sizeof *table);
+    if (!table)
+        return true;
+    memset(table, 0, slots * sizeof *table);
+    const struct axientry *entries = p->entries->chunks;
+    for (uint64_t id = 0; id < p->entries->len; ++id) {
+        uint64_t slot = entries[id].hash & (slots - 1);
+        while (table[slot])
+            slot = (slot + 1) & (slots - 1);
+        table[slot] = (uint32_t) id + 1;
+    }
+    axc__free__(p->table);
+    p->table = table;
+    p->mask = slots - 1;
+    return false;
+}
+
+axintern *axi_new(void) {
+    axintern *p = axc__malloc__(sizeof *p);
+    if (!p)
+        return NULL;
+    p->arena = axc_newSized(1, 1024);
+    p->entries = axc_new(sizeof(struct axientry));
+    p->table = axc__malloc__(AXI_TABLE_SIZE * sizeof *p->table);
+    p->mask = AXI_TABLE_SIZE - 1;
+    if (!p->arena || !p->entries || !p->table) {
+        if (p->arena)
+            axc_destroy(p->arena);
+        if (p->entries)
+            axc_destroy(p->entries);
+        axc__free__(p->table);
+        axc__free__(p);
+        return NULL;
+    }
+    memset(p->table, 0, AXI_TABLE_SIZE * sizeof *p->table);
+    return p;
+}
+
+void axi_destroy(axintern *p) {
+    axc_destroy(p->arena);
+    axc_destroy(p->entries);
+    axc__free__(p->table);
+    axc__free__(p);
+}
+
+uint32_t axi_intern(axintern *p, const void *data, uint64_t size) {
+    if (size > UINT32_MAX)
+        return AXI_NONE;
+    const uint32_t hash = axi__hash__(data, size);
+    uint64_t slot = axi__probe__(p, data, size, hash);
+    if (p->table[slot])
+        return p->table[slot] - 1;
+
+    // IDs are stored plus one in the table, and AXI_NONE is no ID
+    const uint64_t id = p->entries->len;
+    if (id >= AXI_NONE - 1)
+        return AXI_NONE;
+    if ((id + 1) * 2 > p->mask + 1) {
+        if (axi__grow__(p))
+            return AXI_NONE;
+        slot = axi__probe__(p, data, size, hash);
+    }
+    struct axientry e = {p->arena->len, (uint32_t) size, hash};
+    if (axc_write(p->arena, p->arena->len, (void *) data, size))
+        return AXI_NONE;
+    if (axc_push(p->entries, &e)) {
+        axc_discard(p->arena, size);
+        return AXI_NONE;
+    }
+    p->table[slot] = (uint32_t) id + 1;
+    return (uint32_t) id;
+}
+
+uint32_t axi_find(axintern *p, const void *data, uint64_t size) {
+    if (size > UINT32_MAX)
+        return AXI_NONE;
+    uint64_t slot = axi__probe__(p, data, size, axi__hash__(data, size));
+    return p->table[slot] ? p->table[slot] - 1 : AXI_NONE;
+}
+
+axcspan axi_get(axintern *p, uint32_t id) {
+    if (id >= p->entries->len)
+        return (axcspan) {NULL, 0};
+    const struct axientry *e = (struct axientry *) p->entries->chunks + id;
+    return (axcspan) {(char *) p->arena->chunks + e->offset, e->len};
+}
+
+axintern *axi_clear(axintern *p) {
+    axc_clear(p->arena);
+    axc_clear(p->entries);
+    memset(p->table, 0, (p->mask + 1) * sizeof *p->table);
+    return p;
+}
@@ -0,0 +1,91 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXCHUNK_AXINTERN_H
+#define AXCHUNK_AXINTERN_H
+
+#include "axvarchunk.h"
+
+/*
+ * ID returned in place of a string that could not be interned or found.
+ */
+#define AXI_NONE UINT32_MAX
+
+/*
+ * axintern is an interning pool that stores every distinct string once and identifies it by a 32-bit ID.
+ *
+ * The bytes of all strings are kept back to back in an arena axchunk of width 1. An entries axchunk holds one
+ * (offset, length, hash) chunk per string, and the ID of a string is the index of its entry, so IDs are dense, start at
+ * zero and never change. Strings are looked up through an open-addressing hash table of IDs. Strings are arbitrary byte
+ * sequences of less than 4 GiB and need not be terminated.
+ *
+ * The struct definition of axintern is given in its header for optimisation purposes only. To use axintern, you must
+ * rely solely on the functions of the library.
+ */
+typedef struct axintern {
+    axchunk *arena;
+    axchunk *entries;
+    uint32_t *table;
+    uint64_t mask;
+} axintern;
+
+/**
+ * Creates a new, empty interning pool.
+ * @return New axintern or NULL iff OOM.
+ */
+axintern *axi_new(void);
+
+/**
+ * Destroys the interning pool.
+ */
+void axi_destroy(axintern *p);
+
+/**
+ * Number of distinct strings interned. This is also the smallest ID not yet handed out.
+ * @return Number of strings.
+ */
+static inline uint64_t axi_len(axintern *p) {
+    return p->entries->len;
+}
+
+/**
+ * Total size of all distinct strings in bytes.
+ * @return Size of the arena.
+ */
+static inline uint64_t axi_bytes(axintern *p) {
+    return p->arena->len;
+}
+
+/**
+ * Intern a string. If an equal string has been interned before, its ID is returned and nothing is stored.
+ * @param data Bytes of the string. Must not point into this pool.
+ * @param size Size of the string in bytes.
+ * @return ID of the string or AXI_NONE iff OOM, the string is too long or the pool has run out of IDs.
+ */
+uint32_t axi_intern(axintern *p, const void *data, uint64_t size);
+
+/**
+ * Look up a string without interning it.
+ * @param data Bytes of the string.
+ * @param size Size of the string in bytes.
+ * @return ID of the string or AXI_NONE if it has not been interned.
+ */
+uint32_t axi_find(axintern *p, const void *data, uint64_t size);
+
+/**
+ * Get the string with some ID. The span is invalidated by any subsequent call to axi_intern.
+ * @param id ID of the string.
+ * @return Span of the string, with a NULL pointer if there is no string with that ID.
+ */
+axcspan axi_get(axintern *p, uint32_t id);
+
+/**
+ * Remove every string. IDs handed out before are no longer valid and will be reused.
+ * @return Self.
+ */
+axintern *axi_clear(axintern *p);
+
+#endif //AXCHUNK_AXINTERN_H
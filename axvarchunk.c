@@ -0,0 +1,90 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axvarchunk.h"
+
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+
+axvarchunk *axvc_new(void) {
+    axvarchunk *v = axc__malloc__(sizeof *v);
+    if (!v)
+        return NULL;
+    v->offsets = axc_new(sizeof(uint64_t));
+    v->blob = axc_newSized(1, 64);
+    uint64_t zero = 0;
+    if (!v->offsets || !v->blob || axc_push(v->offsets, &zero)) {
+        if (v->offsets)
+            axc_destroy(v->offsets);
+        if (v->blob)
+            axc_destroy(v->blob);
+        axc__free__(v);
+        return NULL;
+    }
+    return v;
+}
+
+void axvc_destroy(axvarchunk *v) {
+    axc_destroy(v->offsets);
+    axc_destroy(v->blob);
+    axc__free__(v);
+}
+
+bool axvc_push(axvarchunk *v, const void *data, uint64_t size) {
+    uint64_t end = v->blob->len + size;
+    if (v->offsets->len >= v->offsets->cap && axc_resize(v->offsets, (v->offsets->cap << 1) | 1))
+        return true;
+    if (axc_write(v->blob, v->blob->len, (void *) data, size))
+        return true;
+    axc_push(v->offsets, &end);
+    return false;
+}
+
+axvarchunk *axvc_discard(axvarchunk *v, uint64_t n) {
+    n = MIN(n, axvc_ulen(v));
+    axc_discard(v->offsets, n);
+    axc_discard(v->blob, v->blob->len - ((uint64_t *) v->offsets->chunks)[axvc_ulen(v)]);
+    return v;
+}
+
+axvarchunk *axvc_clear(axvarchunk *v) {
+    axc_discard(v->offsets, axvc_ulen(v));
+    axc_clear(v->blob);
+    return v;
+}
+
+axvarchunk *axvc_foreach(axvarchunk *v, bool (*f)(void *, uint64_t, void *), void *arg) {
+    const uint64_t *offsets = v->offsets->chunks;
+    char *blob = v->blob->chunks;
+    for (uint64_t i = 0; i < axvc_ulen(v); ++i) {
+        if (!f(blob + offsets[i], offsets[i + 1] - offsets[i], arg))
+            return v;
+    }
+    return v;
+}
+
+axvarchunk *axvc_filter(axvarchunk *v, bool (*f)(const void *, uint64_t, void *), void *arg) {
+    uint64_t *offsets = v->offsets->chunks;
+    char *blob = v->blob->chunks;
+    const uint64_t len = axvc_ulen(v);
+    uint64_t kept = 0;
+    uint64_t end = 0;
+    uint64_t start = offsets[0];
+    for (uint64_t i = 0; i < len; ++i) {
+        // offsets[i] may already have been overwritten, so the start of the record is carried over from the last one
+        const uint64_t next = offsets[i + 1];
+        const uint64_t size = next - start;
+        if (f(blob + start, size, arg)) {
+            if (end != start)
+                memmove(blob + end, blob + start, size);
+            end += size;
+            offsets[++kept] = end;
+        }
+        start = next;
+    }
+    v->offsets->len = kept + 1;
+    v->blob->len = end;
+    return v;
+}
@@ -0,0 +1,126 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXCHUNK_AXVARCHUNK_H
+#define AXCHUNK_AXVARCHUNK_H
+
+#include "axchunk.h"
+
+/*
+ * axvarchunk is a vector of variable-length records built on two axchunks.
+ *
+ * The bytes of all records are stored back to back in a blob axchunk of width 1. An offsets axchunk of width 8 holds
+ * the offset at which each record starts, followed by the offset one past the end of the last record. Storing a record
+ * therefore costs a copy into the blob and eight bytes, not a separate allocation per record.
+ *
+ * Records are handed out as spans pointing into the blob. A span is invalidated by any function that adds records,
+ * because the blob may be resized, and by any function that removes records.
+ *
+ * The struct definition of axvarchunk is given in its header for optimisation purposes only. To use axvarchunk, you
+ * must rely solely on the functions of the library.
+ */
+typedef struct axvarchunk {
+    axchunk *offsets;
+    axchunk *blob;
+} axvarchunk;
+
+/*
+ * A record of an axvarchunk: a pointer to its first byte and its size in bytes.
+ */
+typedef struct axcspan {
+    void *ptr;
+    uint64_t len;
+} axcspan;
+
+/**
+ * Creates a new, empty axvarchunk.
+ * @return New axvarchunk or NULL iff OOM.
+ */
+axvarchunk *axvc_new(void);
+
+/**
+ * Destroys the axvarchunk.
+ */
+void axvc_destroy(axvarchunk *v);
+
+/**
+ * Unsigned number of records.
+ * @return Unsigned length of axvarchunk.
+ */
+static inline uint64_t axvc_ulen(axvarchunk *v) {
+    return v->offsets->len - 1;
+}
+
+/**
+ * Signed number of records.
+ * @return Signed length of axvarchunk.
+ */
+static inline int64_t axvc_len(axvarchunk *v) {
+    return (int64_t) v->offsets->len - 1;
+}
+
+/**
+ * Total size of all records in bytes.
+ * @return Size of the blob.
+ */
+static inline uint64_t axvc_bytes(axvarchunk *v) {
+    return v->blob->len;
+}
+
+/**
+ * Get the i-th record.
+ * @param i Index of record.
+ * @return Span of the record, with a NULL pointer if index out of range.
+ */
+static inline axcspan axvc_get(axvarchunk *v, uint64_t i) {
+    if (i >= axvc_ulen(v))
+        return (axcspan) {NULL, 0};
+    const uint64_t *offsets = v->offsets->chunks;
+    return (axcspan) {(char *) v->blob->chunks + offsets[i], offsets[i + 1] - offsets[i]};
+}
+
+/**
+ * Append a record. This operation may resize the axvarchunk.
+ * @param data Bytes of the record. Must not point into this axvarchunk.
+ * @param size Size of the record in bytes.
+ * @return True iff OOM, in which case nothing is done.
+ */
+bool axvc_push(axvarchunk *v, const void *data, uint64_t size);
+
+/**
+ * Remove the last n records.
+ * @param n Number of records to discard. This is automatically clamped to the number of records.
+ * @return Self.
+ */
+axvarchunk *axvc_discard(axvarchunk *v, uint64_t n);
+
+/**
+ * Remove every record.
+ * @return Self.
+ */
+axvarchunk *axvc_clear(axvarchunk *v);
+
+/**
+ * Let f be a function taking (pointer to record, size of record, optional argument).
+ * Call f(x, n, arg) on each record until f returns false or all records have been exhausted.
+ * Records are iterated from first to last.
+ * @param f Function to call on all records.
+ * @param arg An optional argument passed to the function.
+ * @return Self.
+ */
+axvarchunk *axvc_foreach(axvarchunk *v, bool (*f)(void *, uint64_t, void *), void *arg);
+
+/**
+ * Let f be a predicate taking (pointer to record, size of record, optional argument).
+ * Keep all records that satisfy f, remove all those that don't, and compact the offsets and the blob in a single pass,
+ * preserving the relative order of the remaining records. O(n).
+ * @param f Some predicate to filter the records.
+ * @param arg An optional argument passed to the filter.
+ * @return Self.
+ */
+axvarchunk *axvc_filter(axvarchunk *v, bool (*f)(const void *, uint64_t, void *), void *arg);
+
+#endif //AXCHUNK_AXVARCHUNK_H
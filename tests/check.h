@@ -0,0 +1,23 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef AXCHUNK_CHECK_H
+#define AXCHUNK_CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Aborts the test program with the failed condition if it does not hold. Unlike assert, this is never compiled out.
+ */
+#define CHECK(x) do { \
+    if (!(x)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); \
+        exit(1); \
+    } \
+} while (0)
+
+#endif //AXCHUNK_CHECK_H
@@ -0,0 +1,192 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axbitchunk.h"
+#include "axcdelta.h"
+#include "axcpack.h"
+#include "axintern.h"
+#include "axvarchunk.h"
+#include "check.h"
+
+typedef struct sample {
+    uint64_t id;
+    uint32_t reading;
+    uint16_t sensor;
+} sample;
+
+static axchunk *samples(uint64_t n, uint64_t step) {
+    axchunk *c = axc_newSized(sizeof(sample), n);
+    CHECK(c);
+    for (uint64_t i = 0; i < n; ++i) {
+        sample s = {0};
+        s.id = 1000000 + i * step + (i % 3);
+        s.reading = (uint32_t) (i % 17);
+        s.sensor = (uint16_t) (i % 5);
+        CHECK(!axc_push(c, &s));
+    }
+    return c;
+}
+
+static bool same(axchunk *a, axchunk *b) {
+    return axc_width(a) == axc_width(b) && axc_ulen(a) == axc_ulen(b)
+           && !memcmp(axc_data(a), axc_data(b), axc_ulen(a) * axc_width(a));
+}
+
+static void testShuffle(void) {
+    for (uint64_t width = 1; width <= 40; ++width) {
+        const uint64_t n = 257;
+        char *src = malloc(n * width), *shuffled = malloc(n * width), *back = malloc(n * width);
+        CHECK(src && shuffled && back);
+        for (uint64_t k = 0; k < n * width; ++k)
+            src[k] = (char) (k * 31 + width);
+        axc_shuffleBytes(src, shuffled, n, width);
+        // byte b of chunk i lands at b * n + i
+        CHECK(shuffled[(width - 1) * n + 5] == src[5 * width + width - 1]);
+        axc_unshuffleBytes(shuffled, back, n, width);
+        CHECK(!memcmp(src, back, n * width));
+        free(src);
+        free(shuffled);
+        free(back);
+    }
+}
+
+static void testPack(void) {
+    axchunk *c = samples(10000, 1);
+    axcpack *p = axp_new(c, 256, 2);
+    CHECK(p && axp_ulen(p) == 10000 && axp_nblocks(p) == 40);
+    const uint64_t hot = axp_storageSize(p);
+    CHECK(axp_compressCold(p) == 40);
+    CHECK(axp_isCold(p, 0) && axp_isCold(p, 39));
+    CHECK(axp_storageSize(p) < hot / 2);
+
+    // random access through a cache smaller than the blocks accessed
+    for (uint64_t i = 0; i < 10000; i += 331) {
+        const sample *s = axp_index(p, i);
+        CHECK(s && !memcmp(s, axc_index(c, i), sizeof *s));
+    }
+    CHECK(!axp_index(p, 10000));
+    sample s = {42, 42, 42};
+    CHECK(!axp_set(p, 300, &s) && !axp_isCold(p, 1));
+    CHECK(axp_set(p, 10000, &s));
+    axc_set(c, 300, &s);
+    CHECK(!axp_push(p, &s) && !axc_push(c, &s));
+    axchunk *back = axp_toAxchunk(p);
+    CHECK(back && same(back, c));
+    axc_destroy(back);
+
+    sample many[600];
+    CHECK(axp_read(p, 9700, many, 600) == 301);
+    CHECK(!memcmp(many, axc_index(c, 9700), 301 * sizeof *many));
+    axp_destroy(p);
+    axc_destroy(c);
+
+    axchunk *empty = axc_new(8);
+    p = axp_new(empty, 0, 0);
+    CHECK(p && !axp_ulen(p) && !axp_index(p, 0));
+    axp_destroy(p);
+    axc_destroy(empty);
+}
+
+static void testDelta(void) {
+    axchunk *c = samples(5000, 4);
+    axcdelta *d = axd_new(c, sizeof(uint64_t));
+    CHECK(d && axd_ulen(d) == 5000 && axd_width(d) == sizeof(sample));
+    CHECK(axd_storageSize(d) < 5000 * sizeof(sample));
+    for (uint64_t i = 0; i < 5000; i += 97) {
+        sample s;
+        CHECK(axd_key(d, i) == ((sample *) axc_index(c, i))->id);
+        CHECK(!memcmp(axd_get(d, i, &s), axc_index(c, i), sizeof s));
+    }
+    uint64_t keys[300];
+    CHECK(axd_readKeys(d, 4800, keys, 300) == 200 && keys[199] == ((sample *) axc_index(c, 4999))->id);
+    CHECK(axd_lowerBound(d, 0) == 0 && axd_lowerBound(d, UINT64_MAX) == 5000);
+    CHECK(axd_lowerBound(d, ((sample *) axc_index(c, 1234))->id) == 1234);
+    axchunk *back = axd_toAxchunk(d);
+    CHECK(back && same(back, c));
+    axc_destroy(back);
+    axd_destroy(d);
+
+    // keys must not decrease, and must be 4 or 8 bytes wide
+    sample s = {0};
+    CHECK(!axc_push(c, &s));
+    CHECK(!axd_new(c, sizeof(uint64_t)));
+    axc_pop(c, &s);
+    CHECK(!axd_new(c, 2));
+    axc_destroy(c);
+}
+
+static void testBitchunk(void) {
+    CHECK(!axb_new(0) && !axb_new(64));
+    for (uint64_t bits = 1; bits <= 63; bits += 7) {
+        axbitchunk *b = axb_new(bits);
+        CHECK(b);
+        const uint64_t mask = ((uint64_t) 1 << bits) - 1;
+        for (uint64_t i = 0; i < 1000; ++i)
+            CHECK(!axb_push(b, i * 0x9e3779b97f4a7c15u & mask));
+        for (uint64_t i = 0; i < 1000; ++i)
+            CHECK(axb_get(b, i) == (i * 0x9e3779b97f4a7c15u & mask));
+        CHECK(!axb_set(b, 500, mask) && axb_get(b, 500) == mask);
+        CHECK(axb_get(b, 499) == (499 * 0x9e3779b97f4a7c15u & mask));
+        CHECK(axb_get(b, 501) == (501 * 0x9e3779b97f4a7c15u & mask));
+        uint64_t values[100];
+        CHECK(axb_read(b, 950, values, 100) == 50 && values[49] == (999 * 0x9e3779b97f4a7c15u & mask));
+        CHECK(axb_pop(b) == values[49] && axb_ulen(b) == 999);
+        axb_destroy(b);
+    }
+}
+
+static void testVarchunk(void) {
+    axvarchunk *v = axvc_new();
+    CHECK(v);
+    char text[64];
+    for (int i = 0; i < 100; ++i) {
+        int n = snprintf(text, sizeof text, "record %d", i * i);
+        CHECK(!axvc_push(v, text, (uint64_t) n));
+    }
+    CHECK(!axvc_push(v, "", 0));
+    CHECK(axvc_ulen(v) == 101);
+    axcspan s = axvc_get(v, 12);
+    CHECK(s.len == 10 && !memcmp(s.ptr, "record 144", 10));
+    CHECK(axvc_get(v, 100).len == 0 && !axvc_get(v, 101).ptr);
+    axvc_discard(v, 51);
+    CHECK(axvc_ulen(v) == 50 && axvc_bytes(v) == ((uint64_t *) v->offsets->chunks)[50]);
+    axvc_destroy(v);
+}
+
+static void testIntern(void) {
+    axintern *p = axi_new();
+    CHECK(p);
+    char text[64];
+    for (uint64_t i = 0; i < 1000; ++i) {
+        int n = snprintf(text, sizeof text, "string %llu", (unsigned long long) (i * i));
+        CHECK(axi_intern(p, text, (uint64_t) n) == i);
+    }
+    CHECK(axi_intern(p, "", 0) == 1000);
+
+    // interning again returns the same IDs and stores nothing
+    const uint64_t bytes = axi_bytes(p);
+    for (uint64_t i = 0; i < 1000; ++i) {
+        int n = snprintf(text, sizeof text, "string %llu", (unsigned long long) (i * i));
+        CHECK(axi_intern(p, text, (uint64_t) n) == i && axi_find(p, text, (uint64_t) n) == i);
+        axcspan back = axi_get(p, (uint32_t) i);
+        CHECK(back.len == (uint64_t) n && !memcmp(back.ptr, text, back.len));
+    }
+    CHECK(axi_bytes(p) == bytes && axi_len(p) == 1001);
+    CHECK(axi_find(p, "missing", 7) == AXI_NONE && !axi_get(p, 1001).ptr);
+    axi_clear(p);
+    CHECK(!axi_len(p) && axi_find(p, "string 0", 8) == AXI_NONE);
+    axi_destroy(p);
+}
+
+int main(void) {
+    testShuffle();
+    testPack();
+    testDelta();
+    testBitchunk();
+    testVarchunk();
+    testIntern();
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axcolumns.h"
+#include "check.h"
+
+typedef struct record {
+    uint64_t id;
+    uint32_t tag;
+    uint8_t flag;
+} record;
+
+static const uint64_t widths[] = {sizeof(uint64_t), sizeof(uint32_t), sizeof(uint8_t)};
+
+static int reallocs;
+static int failingRealloc;
+
+/*
+ * realloc that fails on the given call, counting from one.
+ */
+static void *flakyRealloc(void *ptr, size_t size) {
+    return ++reallocs == failingRealloc ? NULL : realloc(ptr, size);
+}
+
+static record packed(uint64_t i) {
+    record r = {0};
+    r.id = i;
+    r.tag = (uint32_t) (i * 3);
+    r.flag = (uint8_t) (i & 1);
+    return r;
+}
+
+static void testRoundTrip(void) {
+    axcolumns *t = axcol_new(widths, 3);
+    CHECK(t && axcol_width(t) == 13);
+    char buf[13];
+    for (uint64_t i = 0; i < 100; ++i) {
+        record r = packed(i);
+        memcpy(buf, &r.id, 8);
+        memcpy(buf + 8, &r.tag, 4);
+        buf[12] = (char) r.flag;
+        CHECK(!axcol_push(t, buf));
+    }
+    CHECK(axcol_ulen(t) == 100);
+    const uint32_t *tags = axcol_column(t, 1);
+    for (uint64_t i = 0; i < 100; ++i)
+        CHECK(tags[i] == i * 3);
+    CHECK(axcol_get(t, 42, buf));
+    uint64_t id;
+    memcpy(&id, buf, 8);
+    CHECK(id == 42 && buf[12] == 0);
+    axcol_destroy(t);
+}
+
+static void testWriteAndRead(void) {
+    axcolumns *t = axcol_newSized(widths, 3, 4);
+    CHECK(t);
+    char records[10 * 13];
+    for (int i = 0; i < 10 * 13; ++i)
+        records[i] = (char) i;
+    CHECK(!axcol_write(t, 0, records, 10));
+    CHECK(axcol_ulen(t) == 10 && axcol_ucap(t) >= 10);
+    char back[10 * 13];
+    CHECK(axcol_read(t, 0, back, 20) == 10 && !memcmp(back, records, sizeof back));
+    CHECK(axcol_pop(t, back) && !memcmp(back, records + 9 * 13, 13));
+    axcol_discard(t, 4);
+    CHECK(axcol_ulen(t) == 5);
+    CHECK(((const uint8_t *) axcol_column(t, 2))[4] == (uint8_t) (4 * 13 + 12));
+    axcol_destroy(t);
+}
+
+static void testResizeRollback(void) {
+    axcolumns *t = axcol_newSized(widths, 3, 4);
+    char buf[13] = {0};
+    for (int i = 0; i < 4; ++i)
+        CHECK(!axcol_push(t, buf));
+
+    // the second column fails to grow, so the first one must be shrunk back
+    axc_memoryfn(malloc, flakyRealloc, free);
+    reallocs = 0;
+    failingRealloc = 2;
+    CHECK(axcol_push(t, buf));
+    axc_memoryfn(malloc, realloc, free);
+    CHECK(axcol_ulen(t) == 4);
+    for (uint64_t k = 0; k < 3; ++k)
+        CHECK(axcol_axchunk(t, k)->cap == axcol_ucap(t));
+
+    for (int i = 0; i < 100; ++i)
+        CHECK(!axcol_push(t, buf));
+    CHECK(axcol_ulen(t) == 104);
+    for (uint64_t k = 0; k < 3; ++k)
+        CHECK(axcol_axchunk(t, k)->cap >= 104);
+    axcol_destroy(t);
+}
+
+int main(void) {
+    testRoundTrip();
+    testWriteAndRead();
+    testResizeRollback();
+    return 0;
+}
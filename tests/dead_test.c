@@ -0,0 +1,172 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axchunk.h"
+#include "check.h"
+
+static axchunk *range(uint64_t n) {
+    axchunk *c = axc_new(sizeof(uint64_t));
+    CHECK(c);
+    for (uint64_t i = 0; i < n; ++i)
+        CHECK(!axc_push(c, &i));
+    return c;
+}
+
+static uint64_t at(axchunk *c, uint64_t i) {
+    return *(uint64_t *) axc_index(c, i);
+}
+
+static bool even(const void *x, void *arg) {
+    (void) arg;
+    return !(*(const uint64_t *) x & 1);
+}
+
+static bool sum(void *x, void *arg) {
+    *(uint64_t *) arg += *(uint64_t *) x;
+    return true;
+}
+
+/*
+ * The dead bitmap is sized when a chunk is killed, so chunks pushed afterwards lie beyond it.
+ */
+static axchunk *killThenGrow(void) {
+    axchunk *c = range(1);
+    axc_setCompactionThreshold(c, 1);
+    CHECK(!axc_kill(c, 0));
+    for (uint64_t i = 1; i < 300; ++i)
+        CHECK(!axc_push(c, &i));
+    CHECK(axc_deadLen(c) == 1);
+    return c;
+}
+
+static void testKillAndCompact(void) {
+    axchunk *c = range(100);
+    axc_setCompactionThreshold(c, 1);
+    CHECK(axc_kill(c, 100));
+    CHECK(!axc_kill(c, 3));
+    CHECK(!axc_kill(c, 3));
+    CHECK(!axc_kill(c, 64));
+    CHECK(axc_deadLen(c) == 2);
+    CHECK(axc_isDead(c, 3) && axc_isDead(c, 64) && !axc_isDead(c, 4));
+    axc_compact(c);
+    CHECK(axc_ulen(c) == 98 && !axc_deadLen(c));
+    CHECK(at(c, 3) == 4 && at(c, 63) == 65);
+    axc_destroy(c);
+
+    // automatic compaction once more than a quarter is dead
+    c = range(8);
+    CHECK(!axc_kill(c, 0) && !axc_kill(c, 1));
+    CHECK(axc_ulen(c) == 8);
+    CHECK(!axc_kill(c, 2));
+    CHECK(axc_ulen(c) == 5 && at(c, 0) == 3);
+    axc_destroy(c);
+}
+
+static void testSkipDead(void) {
+    axchunk *c = range(200);
+    axc_setCompactionThreshold(c, 1);
+    for (uint64_t i = 0; i < 200; i += 3)
+        CHECK(!axc_kill(c, i));
+    uint64_t total = 0, expected = 0;
+    for (uint64_t i = 0; i < 200; ++i)
+        expected += i % 3 ? i : 0;
+    axc_foreach(c, sum, &total);
+    CHECK(total == expected);
+
+    // writing to a dead chunk revives it
+    // as wide as the widest chunk the inline copies specialise for, so that the compiler sees no overread
+    uint64_t x[2] = {1000};
+    CHECK(!axc_set(c, 3, x) && !axc_isDead(c, 3) && axc_deadLen(c) == 66);
+    axc_filter(c, even, NULL);
+    CHECK(!axc_deadLen(c));
+    for (uint64_t i = 0; i < axc_ulen(c); ++i)
+        CHECK(at(c, i) % 2 == 0 && (at(c, i) % 3 || at(c, i) == 1000));
+    axc_destroy(c);
+}
+
+static void testUnique(void) {
+    axchunk *c = range(300);
+    axc_setCompactionThreshold(c, 1);
+    for (uint64_t i = 0; i < 300; ++i) {
+        uint64_t x[2] = {i / 3};
+        axc_set(c, i, x);
+    }
+    CHECK(!axc_kill(c, 0) && !axc_kill(c, 1) && !axc_kill(c, 2) && !axc_kill(c, 4));
+    axc_unique(c);
+    CHECK(axc_ulen(c) == 99 && !axc_deadLen(c));
+    for (uint64_t i = 0; i < axc_ulen(c); ++i)
+        CHECK(at(c, i) == i + 1);
+    axc_destroy(c);
+
+    c = range(300);
+    axc_setCompactionThreshold(c, 1);
+    for (uint64_t i = 0; i < 300; ++i) {
+        uint64_t x[2] = {i % 7};
+        axc_set(c, i, x);
+    }
+    CHECK(!axc_kill(c, 0));
+    CHECK(axc_dedupHashed(c));
+    CHECK(axc_ulen(c) == 7 && !axc_deadLen(c));
+    for (uint64_t i = 0; i < axc_ulen(c); ++i)
+        CHECK(at(c, i) == (i + 1) % 7);
+    axc_destroy(c);
+}
+
+static void testSwapAfterGrowth(void) {
+    axchunk *c = killThenGrow();
+    axc_swap(c, 0, 250);
+    CHECK(!axc_isDead(c, 0) && axc_isDead(c, 250));
+    CHECK(at(c, 0) == 250 && at(c, 250) == 0);
+    CHECK(axc_deadLen(c) == 1);
+    axc_swap(c, 250, 1);
+    CHECK(axc_isDead(c, 1) && !axc_isDead(c, 250));
+    axc_compact(c);
+    CHECK(axc_ulen(c) == 299 && at(c, 1) == 2);
+    axc_destroy(c);
+}
+
+static void testFilterAfterGrowth(void) {
+    axchunk *c = killThenGrow();
+    axc_filter(c, even, NULL);
+    CHECK(axc_ulen(c) == 149 && !axc_deadLen(c));
+    for (uint64_t i = 0; i < axc_ulen(c); ++i)
+        CHECK(at(c, i) == 2 * i + 2);
+    axc_destroy(c);
+}
+
+static void testUniqueAfterGrowth(void) {
+    axchunk *c = killThenGrow();
+    for (uint64_t i = 1; i < 300; ++i) {
+        uint64_t x[2] = {i / 3};
+        axc_set(c, i, x);
+    }
+    axc_unique(c);
+    CHECK(axc_ulen(c) == 100 && !axc_deadLen(c));
+    for (uint64_t i = 0; i < axc_ulen(c); ++i)
+        CHECK(at(c, i) == i);
+    axc_destroy(c);
+
+    c = killThenGrow();
+    for (uint64_t i = 1; i < 300; ++i) {
+        uint64_t x[2] = {i % 7};
+        axc_set(c, i, x);
+    }
+    CHECK(axc_dedupHashed(c));
+    CHECK(axc_ulen(c) == 7 && !axc_deadLen(c));
+    for (uint64_t i = 0; i < axc_ulen(c); ++i)
+        CHECK(at(c, i) == (i + 1) % 7);
+    axc_destroy(c);
+}
+
+int main(void) {
+    testKillAndCompact();
+    testSkipDead();
+    testUnique();
+    testSwapAfterGrowth();
+    testFilterAfterGrowth();
+    testUniqueAfterGrowth();
+    return 0;
+}
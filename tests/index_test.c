@@ -0,0 +1,97 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axchunk.h"
+#include "check.h"
+
+/*
+ * An axchunk whose chunk i holds bytes derived from i, so that any misplaced byte is detected.
+ */
+static axchunk *pattern(uint64_t n, uint64_t width) {
+    axchunk *c = axc_newSized(width, n);
+    CHECK(c);
+    char chunk[64];
+    for (uint64_t i = 0; i < n; ++i) {
+        for (uint64_t b = 0; b < width; ++b)
+            chunk[b] = (char) (i * 7 + b);
+        CHECK(!axc_push(c, chunk));
+    }
+    return c;
+}
+
+static uint64_t destroyedSum;
+
+static void sumDestroyed(void *chunk) {
+    destroyedSum += *(uint64_t *) chunk;
+}
+
+/*
+ * Gathers from an axchunk of n chunks, with every tenth index out of range if outliers is set.
+ */
+static void checkGather(uint64_t width, bool outliers) {
+    const uint64_t n = 5000, count = 1003;
+    axchunk *c = pattern(n, width);
+    uint64_t *indices = malloc(count * sizeof *indices);
+    char *out = malloc(count * width);
+    CHECK(indices && out);
+    for (uint64_t k = 0; k < count; ++k)
+        indices[k] = outliers && k % 10 == 9 ? n + k : k * 2654435761u % n;
+    memset(out, 0x5a, count * width);
+    CHECK(axc_gather(c, indices, count, out) == count - (outliers ? count / 10 : 0));
+    for (uint64_t k = 0; k < count; ++k) {
+        const char *chunk = out + k * width;
+        for (uint64_t b = 0; b < width; ++b)
+            CHECK(chunk[b] == (indices[k] < n ? (char) (indices[k] * 7 + b) : 0x5a));
+    }
+    free(indices);
+    free(out);
+    axc_destroy(c);
+}
+
+static void testScatter(void) {
+    axchunk *c = pattern(100, 8);
+    axc_setCompactionThreshold(c, 1);
+    CHECK(!axc_kill(c, 10));
+    const uint64_t indices[] = {10, 99, 100, 0};
+    const uint64_t values[] = {1, 2, 3, 4};
+    CHECK(axc_scatter(c, indices, 4, (void *) values) == 3);
+    CHECK(axc_ulen(c) == 100 && !axc_isDead(c, 10) && !axc_deadLen(c));
+    CHECK(*(uint64_t *) axc_index(c, 10) == 1 && *(uint64_t *) axc_index(c, 99) == 2);
+    CHECK(*(uint64_t *) axc_index(c, 0) == 4);
+    axc_destroy(c);
+}
+
+static void testScatterDestroys(void) {
+    axchunk *c = axc_new(sizeof(uint64_t));
+    CHECK(c);
+    for (uint64_t i = 0; i < 10; ++i) {
+        uint64_t x = 1 << i;
+        CHECK(!axc_push(c, &x));
+    }
+    axc_setDestructor(c, sumDestroyed);
+    destroyedSum = 0;
+
+    // the chunk at 2 is overwritten twice, so its first replacement is destroyed as well
+    const uint64_t indices[] = {2, 7, 2, 10};
+    const uint64_t values[] = {1000, 2000, 3000, 4000};
+    CHECK(axc_scatter(c, indices, 4, (void *) values) == 3);
+    CHECK(destroyedSum == (1 << 2) + (1 << 7) + 1000);
+    CHECK(*(uint64_t *) axc_index(c, 2) == 3000 && *(uint64_t *) axc_index(c, 7) == 2000);
+    destroyedSum = 0;
+    axc_destroy(c);
+    CHECK(destroyedSum == 1023 - (1 << 2) - (1 << 7) + 3000 + 2000);
+}
+
+int main(void) {
+    const uint64_t widths[] = {1, 4, 8, 13, 32};
+    for (int k = 0; k < 5; ++k) {
+        checkGather(widths[k], false);
+        checkGather(widths[k], true);
+    }
+    testScatter();
+    testScatterDestroys();
+    return 0;
+}
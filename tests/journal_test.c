@@ -0,0 +1,197 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axchunk.h"
+#include "check.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+static axchunk *range(uint64_t n) {
+    axchunk *c = axc_new(sizeof(uint64_t));
+    CHECK(c);
+    for (uint64_t i = 0; i < n; ++i)
+        CHECK(!axc_push(c, &i));
+    return c;
+}
+
+static bool notMultipleOfThree(const void *x, void *arg) {
+    (void) arg;
+    return *(const uint64_t *) x % 3;
+}
+
+/*
+ * Changes the axchunk through every journaled function, including automatic compactions.
+ */
+static void mutate(axchunk *c, uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+        uint64_t x = i * 7 % 13;
+        CHECK(!axc_push(c, &x));
+    }
+    uint64_t x = 99;
+    CHECK(!axc_set(c, 5, &x));
+    uint64_t many[40];
+    for (uint64_t k = 0; k < 40; ++k)
+        many[k] = k;
+    CHECK(!axc_write(c, axc_ulen(c) - 10, many, 40));
+    axc_discard(c, 3);
+    axc_swap(c, 3, axc_ulen(c) - 1);
+    for (uint64_t i = 10; i < axc_ulen(c) / 2; i += 2)
+        CHECK(!axc_kill(c, i));
+    CHECK(!axc_kill(c, 1));
+    axc_filter(c, notMultipleOfThree, NULL);
+    axc_unique(c);
+    uint64_t indices[3] = {1, 2, 1 << 30};
+    uint64_t values[3] = {5, 6, 7};
+    axc_scatter(c, indices, 3, values);
+    CHECK(!axc_prefixSum(c, 0, AXC_U64, false, NULL));
+    axc_pop(c, &x);
+    CHECK(!axc_kill(c, 4));
+    for (uint64_t i = 0; i < 50; ++i) {
+        x = i % 4;
+        CHECK(!axc_push(c, &x));
+    }
+    CHECK(axc_dedupHashed(c));
+    CHECK(!axc_kill(c, 0));
+}
+
+static void checkReplayed(axchunk *snapshot, axchunk *c) {
+    CHECK(axc_equal(snapshot, c));
+    CHECK(axc_deadLen(snapshot) == axc_deadLen(c));
+    for (uint64_t i = 0; i < axc_ulen(c); ++i)
+        CHECK(axc_isDead(snapshot, i) == axc_isDead(c, i));
+}
+
+static void testInMemory(void) {
+    axchunk *c = range(10);
+    axchunk *snapshot = axc_copy(c);
+    CHECK(!axc_journal(c, -1, 0));
+    mutate(c, 1000);
+    axchunk *buffer = axc_journalBuffer(c);
+    CHECK(buffer && axc_ulen(buffer));
+    CHECK(!axc_replay(snapshot, axc_data(buffer), axc_ulen(buffer)));
+    checkReplayed(snapshot, c);
+    // replaying is not journaled
+    CHECK(!axc_journalBuffer(snapshot));
+    CHECK(!axc_journalEnd(c));
+    CHECK(!axc_journalBuffer(c) && axc_journalFlush(c));
+    axc_destroy(snapshot);
+    axc_destroy(c);
+}
+
+static void testTornTail(void) {
+    axchunk *c = range(10);
+    axchunk *start = axc_copy(c);
+    CHECK(!axc_journal(c, -1, 0));
+    mutate(c, 60);
+    axchunk *buffer = axc_journalBuffer(c);
+    // every prefix of a journal replays without error, up to the last complete record
+    for (uint64_t size = 0; size < axc_ulen(buffer); ++size) {
+        axchunk *snapshot = axc_copy(start);
+        CHECK(!axc_replay(snapshot, axc_data(buffer), size));
+        axc_destroy(snapshot);
+    }
+    CHECK(!axc_journalEnd(c));
+
+    // records that do not fit the axchunk are rejected
+    CHECK(!axc_journal(c, -1, 0));
+    CHECK(!axc_kill(c, 8));
+    buffer = axc_journalBuffer(c);
+    axchunk *other = range(3);
+    CHECK(axc_replay(other, axc_data(buffer), axc_ulen(buffer)));
+    char bogus = 0x7f;
+    CHECK(axc_replay(other, &bogus, 1));
+    axc_destroy(other);
+    axc_destroy(start);
+    axc_destroy(c);
+}
+
+static void testFile(void) {
+    axchunk *c = range(10);
+    axchunk *snapshot = axc_copy(c);
+    int fd = open("journal.bin", O_RDWR | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+    CHECK(!axc_journal(c, fd, 128));
+    mutate(c, 1000);
+    CHECK(!axc_journalFlush(c));
+    CHECK(!axc_ulen(axc_journalBuffer(c)));
+    CHECK(!axc_journalEnd(c));
+    CHECK(lseek(fd, 0, SEEK_SET) == 0);
+    CHECK(!axc_replayFd(snapshot, fd));
+    checkReplayed(snapshot, c);
+    close(fd);
+    unlink("journal.bin");
+    axc_destroy(snapshot);
+    axc_destroy(c);
+}
+
+static void testFailedWrite(void) {
+    axchunk *c = range(10);
+    axchunk *snapshot = axc_copy(c);
+    int fd = open("/dev/null", O_RDONLY);
+    CHECK(fd >= 0);
+    CHECK(!axc_journal(c, fd, 64));
+    mutate(c, 100);
+
+    // the records that could not be written are kept rather than dropped
+    CHECK(axc_journalFlush(c));
+    axchunk *buffer = axc_journalBuffer(c);
+    axchunk *inMemory = axc_copy(snapshot);
+    CHECK(!axc_replay(inMemory, axc_data(buffer), axc_ulen(buffer)));
+    checkReplayed(inMemory, c);
+    axc_destroy(inMemory);
+
+    // once the descriptor accepts writes, the next flush writes every record
+    int file = open("failed.bin", O_RDWR | O_CREAT | O_TRUNC, 0600);
+    CHECK(file >= 0 && dup2(file, fd) == fd);
+    CHECK(!axc_journalFlush(c));
+    CHECK(!axc_journalEnd(c));
+    CHECK(lseek(fd, 0, SEEK_SET) == 0);
+    CHECK(!axc_replayFd(snapshot, fd));
+    checkReplayed(snapshot, c);
+    close(file);
+    close(fd);
+    unlink("failed.bin");
+    axc_destroy(snapshot);
+    axc_destroy(c);
+}
+
+static int destroyed = 0;
+
+static void countDestroyed(void *chunk) {
+    (void) chunk;
+    ++destroyed;
+}
+
+static void testPopKeepsChunk(void) {
+    axchunk *c = range(10);
+    axchunk *snapshot = axc_copy(c);
+    CHECK(snapshot);
+    axc_setDestructor(c, countDestroyed);
+    axc_setDestructor(snapshot, countDestroyed);
+    CHECK(!axc_journal(c, -1, 0));
+    uint64_t x[2];
+    axc_pop(c, x);
+    axc_discard(c, 2);
+    CHECK(x[0] == 9 && destroyed == 2);
+    axchunk *buffer = axc_journalBuffer(c);
+    // the popped chunk belongs to whoever popped it, so only the discarded ones are destroyed again
+    CHECK(!axc_replay(snapshot, axc_data(buffer), axc_ulen(buffer)));
+    CHECK(destroyed == 4 && axc_equal(snapshot, c));
+    CHECK(!axc_journalEnd(c));
+    axc_setDestructor(snapshot, NULL);
+    axc_setDestructor(c, NULL);
+    axc_destroy(snapshot);
+    axc_destroy(c);
+}
+
+int main(void) {
+    testInMemory();
+    testTornTail();
+    testFile();
+    testFailedWrite();
+    testPopKeepsChunk();
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axchunk.h"
+#include "check.h"
+
+typedef struct mixed {
+    uint8_t tag;
+    int16_t small;
+    int32_t value;
+    float ratio;
+    uint64_t total;
+} mixed;
+
+static uint64_t next(uint64_t *state) {
+    *state = *state * 6364136223846793005u + 1442695040888963407u;
+    return *state >> 33;
+}
+
+/*
+ * Chunks of the given width whose leading field holds numbers of the given type, with every ninth chunk killed.
+ */
+static axchunk *numbers(uint64_t n, axctype type, uint64_t width) {
+    axchunk *c = axc_newSized(width, n);
+    CHECK(c);
+    uint64_t seed = n;
+    char chunk[sizeof(mixed)] = {0};
+    for (uint64_t i = 0; i < n; ++i) {
+        const int64_t x = (int64_t) (next(&seed) % 20001) - 10000;
+        switch (type) {
+        case AXC_I32: { int32_t v = (int32_t) x; memcpy(chunk, &v, sizeof v); break; }
+        case AXC_U32: { uint32_t v = (uint32_t) (x + 10000); memcpy(chunk, &v, sizeof v); break; }
+        case AXC_F32: { float v = (float) x; memcpy(chunk, &v, sizeof v); break; }
+        case AXC_F64: { double v = (double) x; memcpy(chunk, &v, sizeof v); break; }
+        default: { int64_t v = x; memcpy(chunk, &v, sizeof v); break; }
+        }
+        CHECK(!axc_push(c, chunk));
+    }
+    axc_setCompactionThreshold(c, 1);
+    for (uint64_t i = 4; i < n; i += 9)
+        CHECK(!axc_kill(c, i));
+    return c;
+}
+
+static double field(axchunk *c, uint64_t i, axctype type) {
+    const void *x = axc_index(c, i);
+    switch (type) {
+    case AXC_I32: { int32_t v; memcpy(&v, x, sizeof v); return v; }
+    case AXC_U32: { uint32_t v; memcpy(&v, x, sizeof v); return v; }
+    case AXC_F32: { float v; memcpy(&v, x, sizeof v); return v; }
+    case AXC_F64: { double v; memcpy(&v, x, sizeof v); return v; }
+    default: { int64_t v; memcpy(&v, x, sizeof v); return (double) v; }
+    }
+}
+
+static double value(axcnum x, axctype type) {
+    return type == AXC_F32 || type == AXC_F64 ? x.f : type == AXC_U32 ? (double) x.u : (double) x.i;
+}
+
+/*
+ * Compares sum, min, max and count with a direct loop. The values are small integers, so even floating-point sums are
+ * exact in any order.
+ */
+static void checkFold(uint64_t n, axctype type, uint64_t width, unsigned threads) {
+    axc_threads(threads);
+    axchunk *c = numbers(n, type, width);
+    double sum = 0, min = 0, max = 0;
+    uint64_t count = 0, live = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        if (axc_isDead(c, i))
+            continue;
+        const double x = field(c, i, type);
+        sum += x;
+        min = live && min < x ? min : x;
+        max = live && max > x ? max : x;
+        count += x != 0;
+        ++live;
+    }
+    CHECK(value(axc_sum(c, 0, type), type) == sum);
+    CHECK(value(axc_min(c, 0, type), type) == min);
+    CHECK(value(axc_max(c, 0, type), type) == max);
+    CHECK(axc_count(c, 0, type) == count);
+    CHECK(!axc_sum(c, width - 1, type).u);
+    axc_destroy(c);
+}
+
+static void checkPrefixSum(uint64_t n, unsigned threads) {
+    axc_threads(threads);
+    axchunk *c = numbers(n, AXC_I64, sizeof(int64_t));
+    int64_t *inclusive = malloc(n * sizeof *inclusive), *exclusive = malloc(n * sizeof *exclusive);
+    CHECK(inclusive && exclusive);
+    CHECK(!axc_prefixSum(c, 0, AXC_I64, true, exclusive));
+    int64_t sum = 0;
+    for (uint64_t i = 0; i < n; ++i) {
+        CHECK(exclusive[i] == sum);
+        sum += axc_isDead(c, i) ? 0 : (int64_t) field(c, i, AXC_I64);
+    }
+    CHECK(!axc_prefixSum(c, 0, AXC_I64, false, inclusive));
+    CHECK(!n || inclusive[n - 1] == sum);
+    CHECK(!axc_prefixSum(c, 0, AXC_I64, false, NULL));
+    CHECK(!n || !memcmp(axc_data(c), inclusive, n * sizeof *inclusive));
+    CHECK(axc_prefixSum(c, 1, AXC_I64, false, NULL));
+    free(inclusive);
+    free(exclusive);
+    axc_destroy(c);
+}
+
+static void addTotals(void *acc, const void *chunk, void *arg) {
+    (void) arg;
+    *(uint64_t *) acc += ((const mixed *) chunk)->total;
+}
+
+static void zero(void *acc, void *arg) {
+    (void) arg;
+    *(uint64_t *) acc = 0;
+}
+
+static void combineTotals(void *acc, const void *other, void *arg) {
+    (void) arg;
+    *(uint64_t *) acc += *(const uint64_t *) other;
+}
+
+static void testStridedFields(void) {
+    axchunk *c = axc_new(sizeof(mixed));
+    CHECK(c);
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < 10000; ++i) {
+        mixed m = {(uint8_t) i, (int16_t) (i % 100 - 50), (int32_t) (i * 3) - 15000, (float) (i % 7), i};
+        CHECK(!axc_push(c, &m));
+        total += i;
+    }
+    CHECK(axc_sum(c, offsetof(mixed, small), AXC_I16).i == -5000);
+    CHECK(axc_min(c, offsetof(mixed, value), AXC_I32).i == -15000);
+    CHECK(axc_max(c, offsetof(mixed, ratio), AXC_F32).f == 6);
+    CHECK(axc_count(c, offsetof(mixed, tag), AXC_U8) == 10000 - 40);
+    uint64_t acc;
+    CHECK(*(uint64_t *) axc_reduce(c, &acc, sizeof acc, zero, addTotals, combineTotals, NULL) == total);
+    CHECK(*(uint64_t *) axc_reduce(c, &acc, sizeof acc, zero, addTotals, NULL, NULL) == total);
+    axc_destroy(c);
+}
+
+static void narrow(const void *src, void *dst, uint64_t n, void *arg) {
+    for (uint64_t k = 0; k < n; ++k) {
+        int64_t x;
+        memcpy(&x, (const char *) src + k * sizeof x, sizeof x);
+        const int32_t y = (int32_t) x + *(const int32_t *) arg;
+        memcpy((char *) dst + k * sizeof y, &y, sizeof y);
+    }
+}
+
+static void checkMap(uint64_t n, unsigned threads) {
+    axc_threads(threads);
+    axchunk *c = numbers(n, AXC_I64, sizeof(int64_t));
+    int32_t offset = 3;
+    axchunk *mapped = axc_map(c, sizeof(int32_t), narrow, &offset);
+    axchunk *parallel = axc_mapParallel(c, sizeof(int32_t), narrow, &offset);
+    CHECK(mapped && parallel && axc_width(mapped) == sizeof(int32_t));
+    CHECK(axc_ulen(mapped) == n - axc_deadLen(c) && axc_ulen(parallel) == axc_ulen(mapped));
+    CHECK(!axc_ulen(mapped) || !memcmp(axc_data(mapped), axc_data(parallel), axc_ulen(mapped) * sizeof(int32_t)));
+    for (uint64_t i = 0, j = 0; i < n; ++i) {
+        if (!axc_isDead(c, i))
+            CHECK(field(mapped, j++, AXC_I32) == field(c, i, AXC_I64) + 3);
+    }
+    axc_destroy(mapped);
+    axc_destroy(parallel);
+    axc_destroy(c);
+}
+
+int main(void) {
+    static const axctype types[] = {AXC_I32, AXC_U32, AXC_F32, AXC_I64, AXC_F64};
+    for (int t = 0; t < 5; ++t) {
+        const uint64_t size = axc_typeSize(types[t]);
+        checkFold(0, types[t], size, 1);
+        checkFold(1000, types[t], size, 1);
+        checkFold(1000, types[t], size + 4, 1);
+        // large enough to be split over threads
+        checkFold(600000, types[t], size, 4);
+    }
+    checkPrefixSum(0, 1);
+    checkPrefixSum(1000, 1);
+    checkPrefixSum(600000, 4);
+    testStridedFields();
+    checkMap(0, 1);
+    checkMap(1000, 1);
+    checkMap(600000, 4);
+    return 0;
+}
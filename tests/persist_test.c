@@ -0,0 +1,230 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axchunk.h"
+#include "check.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+static int destroyed;
+
+static void countDestroyed(void *chunk) {
+    (void) chunk;
+    ++destroyed;
+}
+
+static axchunk *range(uint64_t n) {
+    axchunk *c = axc_new(sizeof(uint64_t));
+    CHECK(c);
+    for (uint64_t i = 0; i < n; ++i)
+        CHECK(!axc_push(c, &i));
+    return c;
+}
+
+static bool same(axchunk *a, axchunk *b) {
+    return axc_width(a) == axc_width(b) && axc_ulen(a) == axc_ulen(b)
+           && !memcmp(axc_data(a), axc_data(b), axc_ulen(a) * axc_width(a));
+}
+
+static void testSaveAndLoad(void) {
+    axchunk *c = range(1000);
+    int fd = open("save.axc", O_RDWR | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+    // the file is written from the start, wherever the descriptor is positioned
+    CHECK(write(fd, "junk", 4) == 4);
+    CHECK(!axc_save(c, fd));
+    CHECK(lseek(fd, 0, SEEK_CUR) == 4);
+    close(fd);
+
+    axchunk *loaded = axc_mmapLoad("save.axc");
+    CHECK(loaded && same(c, loaded) && !axc_verify(loaded));
+    uint64_t x = 7;
+    CHECK(!axc_push(loaded, &x));
+    CHECK(axc_verify(loaded));
+    CHECK(axc_ulen(loaded) == 1001 && *(uint64_t *) axc_index(loaded, 999) == 999);
+    axc_destroy(loaded);
+
+    // a corrupted chunk is found by axc_verify, not by the loader
+    fd = open("save.axc", O_RDWR);
+    CHECK(pwrite(fd, "X", 1, 4096 + 800) == 1);
+    close(fd);
+    loaded = axc_mmapLoad("save.axc");
+    CHECK(loaded && axc_verify(loaded));
+    axc_destroy(loaded);
+
+    // a corrupted header is rejected
+    fd = open("save.axc", O_RDWR);
+    CHECK(pwrite(fd, "X", 1, 0) == 1);
+    close(fd);
+    CHECK(!axc_mmapLoad("save.axc"));
+    unlink("save.axc");
+    axc_destroy(c);
+}
+
+static void testFileBacked(void) {
+    axchunk *c = axc_newFileBacked("backed.axc", sizeof(uint64_t), 4);
+    CHECK(c);
+    for (uint64_t i = 0; i < 100; ++i)
+        CHECK(!axc_push(c, &i));
+    CHECK(!axc_sync(c));
+    axc_destroy(c);
+    // the chunk checksum is not maintained in place
+    c = axc_mmapLoad("backed.axc");
+    CHECK(c && axc_ulen(c) == 100 && axc_verify(c));
+    axc_destroy(c);
+
+    // the length survives a destructor, which must not be recorded as removing every chunk
+    c = axc_newFileBacked("backed.axc", 0, 0);
+    CHECK(c && axc_ulen(c) == 100 && axc_width(c) == sizeof(uint64_t));
+    CHECK(*(uint64_t *) axc_index(c, 99) == 99);
+    axc_setDestructor(c, countDestroyed);
+    destroyed = 0;
+    axc_destroy(c);
+    CHECK(destroyed == 100);
+
+    c = axc_newFileBacked("backed.axc", sizeof(uint64_t), 0);
+    CHECK(c && axc_ulen(c) == 100);
+    CHECK(!axc_resize(c, 10));
+    CHECK(axc_ulen(c) == 10 && axc_ucap(c) == 10);
+    axc_destroy(c);
+    c = axc_newFileBacked("backed.axc", sizeof(uint64_t), 0);
+    CHECK(c && axc_ulen(c) == 10 && *(uint64_t *) axc_index(c, 9) == 9);
+    axc_destroy(c);
+    unlink("backed.axc");
+}
+
+static void testSyncDirtyBlocks(void) {
+    axchunk *c = axc_newFileBacked("dirty.axc", sizeof(uint64_t), 4096);
+    CHECK(c);
+    for (uint64_t i = 0; i < 4096; ++i)
+        CHECK(!axc_push(c, &i));
+    CHECK(!axc_trackDirty(c, 512));
+    uint64_t x = 77;
+    CHECK(!axc_set(c, 600, &x) && !axc_set(c, 4000, &x));
+
+    // a full sync leaves the dirty blocks to axc_takeDirty
+    CHECK(!axc_sync(c));
+    axchunk *blocks = axc_new(sizeof(uint64_t));
+    CHECK(!axc_takeDirty(c, blocks) && axc_ulen(blocks) == 2);
+    CHECK(*(uint64_t *) axc_index(blocks, 0) == 1 && *(uint64_t *) axc_index(blocks, 1) == 7);
+    axc_clear(blocks);
+
+    // syncing the dirty blocks consumes them
+    x = 78;
+    CHECK(!axc_set(c, 700, &x));
+    CHECK(!axc_syncDirty(c));
+    CHECK(!axc_takeDirty(c, blocks) && !axc_ulen(blocks));
+    x = 77;
+    CHECK(!axc_set(c, 10, &x));
+    CHECK(!axc_takeDirty(c, blocks) && axc_ulen(blocks) == 1 && *(uint64_t *) axc_index(blocks, 0) == 0);
+    axc_destroy(blocks);
+    axc_destroy(c);
+
+    c = axc_newFileBacked("dirty.axc", sizeof(uint64_t), 0);
+    CHECK(c && axc_ulen(c) == 4096);
+    CHECK(*(uint64_t *) axc_index(c, 600) == 77 && *(uint64_t *) axc_index(c, 4000) == 77);
+    CHECK(*(uint64_t *) axc_index(c, 700) == 78);
+    CHECK(*(uint64_t *) axc_index(c, 10) == 77 && *(uint64_t *) axc_index(c, 11) == 11);
+    axc_destroy(c);
+    unlink("dirty.axc");
+}
+
+/*
+ * Writes the chunks of c to a file in the on-disk format with the given alignment, as a machine with another page size
+ * would.
+ */
+static void writeAligned(axchunk *c, const char *path, uint64_t alignment) {
+    uint64_t header[7] = {0};
+    memcpy(header, "AXCHUNK", 8);
+    header[1] = 1;
+    header[2] = axc_width(c);
+    header[3] = axc_ulen(c);
+    header[4] = alignment;
+    header[5] = axc__hash__(axc_data(c), axc_width(c) * axc_ulen(c), 0);
+    header[6] = axc__hash__(header, 48, 0);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+    CHECK(pwrite(fd, header, sizeof header, 0) == sizeof header);
+    const uint64_t size = axc_width(c) * axc_ulen(c);
+    CHECK(pwrite(fd, axc_data(c), size, (off_t) alignment) == (ssize_t) size);
+    close(fd);
+}
+
+static void testForeignAlignment(void) {
+    axchunk *c = range(5000);
+    writeAligned(c, "aligned.axc", 65536);
+    axchunk *loaded = axc_mmapLoad("aligned.axc");
+    CHECK(loaded && axc_equal(c, loaded));
+    axc_destroy(loaded);
+    axcjob *job = axc_loadAsync("aligned.axc", 2, NULL, NULL);
+    CHECK(job && !axc_wait(job, &loaded));
+    CHECK(loaded && axc_equal(c, loaded));
+    axc_destroy(loaded);
+
+    // growing a file-backed axchunk keeps the alignment of the file
+    loaded = axc_newFileBacked("aligned.axc", sizeof(uint64_t), 0);
+    CHECK(loaded && axc_equal(c, loaded));
+    for (uint64_t i = 5000; i < 6000; ++i)
+        CHECK(!axc_push(loaded, &i) && !axc_push(c, &i));
+    axc_destroy(loaded);
+    loaded = axc_mmapLoad("aligned.axc");
+    CHECK(loaded && axc_equal(c, loaded));
+    axc_destroy(loaded);
+
+    writeAligned(c, "aligned.axc", 4096 + 64);
+    CHECK(!axc_mmapLoad("aligned.axc"));
+    unlink("aligned.axc");
+    axc_destroy(c);
+}
+
+static void markDone(axcjob *job, int error, void *arg) {
+    (void) job;
+    *(int *) arg = error + 1;
+}
+
+static void testAsync(void) {
+    // large enough for several extents, and not a whole number of pages
+    axchunk *c = range((3 << 20) + 5);
+    int saved = 0;
+    axcjob *job = axc_saveAsync(c, "async.axc", 3, markDone, &saved);
+    CHECK(job);
+    CHECK(!axc_wait(job, NULL));
+    CHECK(saved == 1);
+
+    int loadedDone = 0;
+    job = axc_loadAsync("async.axc", 0, markDone, &loadedDone);
+    CHECK(job);
+    axchunk *loaded = NULL;
+    CHECK(!axc_wait(job, &loaded));
+    CHECK(loadedDone == 1 && loaded && same(c, loaded));
+    axc_destroy(loaded);
+
+    // the synchronous loader reads what the asynchronous saver wrote and vice versa
+    loaded = axc_mmapLoad("async.axc");
+    CHECK(loaded && same(c, loaded));
+    // the chunks of a mapping are page-aligned
+    job = axc_saveAsync(loaded, "async2.axc", 2, NULL, NULL);
+    CHECK(job && !axc_wait(job, NULL));
+    axc_destroy(loaded);
+    loaded = axc_mmapLoad("async2.axc");
+    CHECK(loaded && same(c, loaded));
+    axc_destroy(loaded);
+    unlink("async2.axc");
+    CHECK(!axc_loadAsync("missing.axc", 0, NULL, NULL));
+    unlink("async.axc");
+    axc_destroy(c);
+}
+
+int main(void) {
+    testSaveAndLoad();
+    testFileBacked();
+    testSyncDirtyBlocks();
+    testForeignAlignment();
+    testAsync();
+    axc_ioUring(false);
+    testAsync();
+    return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axchunk.h"
+#include "check.h"
+
+typedef struct row {
+    uint32_t key;
+    int32_t value;
+    double weight;
+} row;
+
+/*
+ * Deterministic pseudo-random numbers, so that failures can be reproduced.
+ */
+static uint64_t next(uint64_t *state) {
+    *state = *state * 6364136223846793005u + 1442695040888963407u;
+    return *state >> 33;
+}
+
+static axchunk *rows(uint64_t n, uint64_t keys, uint64_t seed) {
+    axchunk *c = axc_newSized(sizeof(row), n);
+    CHECK(c);
+    for (uint64_t i = 0; i < n; ++i) {
+        row r = {(uint32_t) (next(&seed) % keys), (int32_t) (next(&seed) % 2001) - 1000, (double) (next(&seed) % 100)};
+        CHECK(!axc_push(c, &r));
+    }
+    return c;
+}
+
+/*
+ * Compares axc_groupBy with a direct computation over an array indexed by key.
+ */
+static void checkGroupBy(uint64_t n, uint64_t keys, unsigned threads) {
+    axc_threads(threads);
+    axchunk *c = rows(n, keys, n + keys);
+    axc_setCompactionThreshold(c, 1);
+    for (uint64_t i = 0; i < n; i += 7)
+        CHECK(!axc_kill(c, i));
+
+    int64_t *sum = calloc(keys, sizeof *sum), *min = calloc(keys, sizeof *min), *max = calloc(keys, sizeof *max);
+    uint64_t *count = calloc(keys, sizeof *count);
+    double *weight = calloc(keys, sizeof *weight);
+    CHECK(sum && min && max && count && weight);
+    for (uint64_t i = 0; i < n; ++i) {
+        if (axc_isDead(c, i))
+            continue;
+        const row *r = axc_index(c, i);
+        sum[r->key] += r->value;
+        min[r->key] = count[r->key] && min[r->key] < r->value ? min[r->key] : r->value;
+        max[r->key] = count[r->key] && max[r->key] > r->value ? max[r->key] : r->value;
+        weight[r->key] += r->weight;
+        ++count[r->key];
+    }
+
+    const axcaggregate aggs[] = {
+        {AXC_AGG_SUM, offsetof(row, value), AXC_I32},
+        {AXC_AGG_MIN, offsetof(row, value), AXC_I32},
+        {AXC_AGG_MAX, offsetof(row, value), AXC_I32},
+        {AXC_AGG_COUNT, 0, AXC_U8},
+        {AXC_AGG_SUM, offsetof(row, weight), AXC_F64},
+    };
+    axchunk *groups = axc_groupBy(c, offsetof(row, key), sizeof(uint32_t), aggs, 5);
+    CHECK(groups && axc_width(groups) == sizeof(uint32_t) + 5 * sizeof(axcnum));
+    uint64_t groupCount = 0;
+    for (uint64_t k = 0; k < keys; ++k)
+        groupCount += !!count[k];
+    CHECK(axc_ulen(groups) == groupCount);
+    for (uint64_t g = 0; g < axc_ulen(groups); ++g) {
+        const char *chunk = axc_index(groups, g);
+        uint32_t key;
+        axcnum agg[5];
+        memcpy(&key, chunk, sizeof key);
+        memcpy(agg, chunk + sizeof key, sizeof agg);
+        CHECK(key < keys && count[key]);
+        CHECK(agg[0].i == sum[key] && agg[1].i == min[key] && agg[2].i == max[key]);
+        CHECK(agg[3].u == count[key] && agg[4].f == weight[key]);
+        // every group appears once
+        count[key] = 0;
+    }
+    axc_destroy(groups);
+
+    const axcaggregate misplaced = {AXC_AGG_SUM, sizeof(row) - 2, AXC_I32};
+    CHECK(!axc_groupBy(c, offsetof(row, key), sizeof(uint32_t), &misplaced, 1));
+    free(sum);
+    free(min);
+    free(max);
+    free(count);
+    free(weight);
+    axc_destroy(c);
+}
+
+static int comparePairs(const void *a, const void *b) {
+    const uint64_t *x = a, *y = b;
+    return x[0] != y[0] ? (x[0] > y[0]) - (x[0] < y[0]) : (x[1] > y[1]) - (x[1] < y[1]);
+}
+
+typedef struct probe {
+    uint16_t tag;
+    uint32_t key;
+} probe;
+
+/*
+ * Compares axc_hashJoin with the number of matches per key, and checks that every emitted pair matches and is unique.
+ */
+static void checkHashJoin(uint64_t nl, uint64_t nr, uint64_t keys, unsigned threads) {
+    axc_threads(threads);
+    axchunk *left = rows(nl, keys, nl);
+    axchunk *right = axc_newSized(sizeof(probe), nr);
+    uint64_t seed = nr;
+    for (uint64_t i = 0; i < nr; ++i) {
+        probe p = {(uint16_t) i, (uint32_t) (next(&seed) % keys)};
+        CHECK(!axc_push(right, &p));
+    }
+    axc_setCompactionThreshold(left, 1);
+    for (uint64_t i = 3; i < nl; i += 11)
+        CHECK(!axc_kill(left, i));
+
+    uint64_t *lc = calloc(keys, sizeof *lc), *rc = calloc(keys, sizeof *rc);
+    CHECK(lc && rc);
+    for (uint64_t i = 0; i < nl; ++i) {
+        if (!axc_isDead(left, i))
+            ++lc[((row *) axc_index(left, i))->key];
+    }
+    for (uint64_t i = 0; i < nr; ++i)
+        ++rc[((probe *) axc_index(right, i))->key];
+    uint64_t expected = 0;
+    for (uint64_t k = 0; k < keys; ++k)
+        expected += lc[k] * rc[k];
+
+    axchunk *pairs = axc_hashJoin(left, offsetof(row, key), right, offsetof(probe, key), sizeof(uint32_t), true);
+    CHECK(pairs && axc_width(pairs) == 2 * sizeof(uint64_t) && axc_ulen(pairs) == expected);
+    uint64_t *p = axc_data(pairs);
+    qsort(p, expected, 2 * sizeof *p, comparePairs);
+    for (uint64_t m = 0; m < expected; ++m) {
+        CHECK(p[2 * m] < nl && p[2 * m + 1] < nr && !axc_isDead(left, p[2 * m]));
+        CHECK(((row *) axc_index(left, p[2 * m]))->key == ((probe *) axc_index(right, p[2 * m + 1]))->key);
+        CHECK(!m || comparePairs(p + 2 * m - 2, p + 2 * m) < 0);
+    }
+    axc_destroy(pairs);
+
+    axchunk *joined = axc_hashJoin(left, offsetof(row, key), right, offsetof(probe, key), sizeof(uint32_t), false);
+    CHECK(joined && axc_width(joined) == sizeof(row) + sizeof(probe) && axc_ulen(joined) == expected);
+    for (uint64_t m = 0; m < expected; ++m) {
+        const char *chunk = axc_index(joined, m);
+        CHECK(((const row *) chunk)->key == ((const probe *) (chunk + sizeof(row)))->key);
+    }
+    axc_destroy(joined);
+    CHECK(!axc_hashJoin(left, sizeof(row) - 2, right, 0, sizeof(uint32_t), true));
+    free(lc);
+    free(rc);
+    axc_destroy(left);
+    axc_destroy(right);
+}
+
+int main(void) {
+    checkGroupBy(0, 1, 1);
+    checkGroupBy(1000, 10, 1);
+    // large enough to be partitioned and spread over threads
+    checkGroupBy(400000, 50000, 1);
+    checkGroupBy(400000, 50000, 4);
+    checkGroupBy(400000, 3, 4);
+    checkHashJoin(0, 10, 5, 1);
+    checkHashJoin(500, 800, 40, 1);
+    // a left side too large for one cache-sized table is partitioned
+    checkHashJoin(200000, 300000, 150000, 1);
+    checkHashJoin(200000, 300000, 150000, 4);
+    checkHashJoin(1000, 400000, 100, 4);
+    return 0;
+}
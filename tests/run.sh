@@ -0,0 +1,22 @@
+#!/bin/sh
+# Builds every test program against the library sources and runs it. Set CC and CFLAGS to override the defaults.
+# On a processor with AVX2, everything is built and run a second time for AVX2, so that the SIMD kernels are tested
+# both behind run-time dispatch and in a build that targets AVX2.
+set -e
+cd "$(dirname "$0")/.."
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:--O1 -g -Wall -Wextra -fsanitize=address,undefined}
+out=$(mktemp -d)
+trap 'rm -rf "$out"' EXIT
+run() {
+    for test in tests/*_test.c; do
+        name=$(basename "$test" .c)
+        $CC $CFLAGS "$@" -I. -pthread "$test" ax*.c -o "$out/$name" -lm
+        (cd "$out" && "./$name")
+        echo "$name${*:+ ($*)}: ok"
+    done
+}
+run
+if grep -qw avx2 /proc/cpuinfo 2>/dev/null; then
+    run -mavx2 -mbmi2
+fi
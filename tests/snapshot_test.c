@@ -0,0 +1,188 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axchunk.h"
+#include "check.h"
+
+static axchunk *range(uint64_t n, uint64_t width) {
+    axchunk *c = axc_newSized(width, n);
+    CHECK(c);
+    char chunk[64] = {0};
+    for (uint64_t i = 0; i < n; ++i) {
+        memcpy(chunk, &i, sizeof i);
+        CHECK(!axc_push(c, chunk));
+    }
+    return c;
+}
+
+static int compareHashes(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Hashes distinct chunks and checks that no two hashes collide.
+ */
+static void checkHash(uint64_t width) {
+    const uint64_t n = width == 1 ? 256 : 20000;
+    uint64_t *hashes = malloc(n * sizeof *hashes);
+    CHECK(hashes);
+    char chunk[64] = {0};
+    for (uint64_t i = 0; i < n; ++i) {
+        memcpy(chunk + width - (width < 2 ? 1 : 2), &i, width < 2 ? 1 : 2);
+        hashes[i] = axc_hash(chunk, width, 1);
+        CHECK(hashes[i] == axc_hash(chunk, width, 1) && hashes[i] != axc_hash(chunk, width, 2));
+    }
+    qsort(hashes, n, sizeof *hashes, compareHashes);
+    for (uint64_t i = 1; i < n; ++i)
+        CHECK(hashes[i] != hashes[i - 1]);
+    free(hashes);
+}
+
+static void checkFingerprint(uint64_t n, uint64_t width) {
+    axchunk *a = range(n, width);
+    axc_threads(1);
+    const uint64_t fingerprint = axc_fingerprint(a);
+    axc_threads(4);
+    CHECK(axc_fingerprint(a) == fingerprint);
+    axchunk *b = axc_copy(a);
+    CHECK(b && axc_fingerprint(b) == fingerprint);
+    if (n) {
+        ((char *) axc_index(b, n / 2))[width - 1] ^= 1;
+        CHECK(axc_fingerprint(b) != fingerprint);
+        axc_discard(b, 1);
+        ((char *) axc_index(b, n / 2))[width - 1] ^= 1;
+        CHECK(n == 1 || axc_fingerprint(b) != fingerprint);
+    }
+    axc_destroy(a);
+    axc_destroy(b);
+}
+
+static void checkDiff(uint64_t n, uint64_t width, unsigned threads) {
+    axc_threads(threads);
+    axchunk *a = range(n, width);
+    axchunk *b = axc_copy(a);
+    axchunk *out = axc_new(sizeof(uint64_t));
+    CHECK(b && out);
+    CHECK(axc_equal(a, b));
+    CHECK(!axc_diff(a, b, out) && !axc_ulen(out));
+
+    // change a byte at either end of some chunks, then make b longer
+    for (uint64_t i = 1; i < n; i += 97)
+        ((char *) axc_index(b, i))[i % 2 ? width - 1 : 0] ^= 1;
+    char chunk[64] = {0};
+    for (int k = 0; k < 5; ++k)
+        CHECK(!axc_push(b, chunk));
+    CHECK(!axc_equal(a, b));
+    CHECK(!axc_diff(a, b, out));
+    uint64_t expected = 0;
+    for (uint64_t i = 1; i < n; i += 97)
+        CHECK(*(uint64_t *) axc_index(out, expected++) == i);
+    for (uint64_t i = n; i < n + 5; ++i)
+        CHECK(*(uint64_t *) axc_index(out, expected++) == i);
+    CHECK(axc_ulen(out) == expected);
+
+    axchunk *narrow = axc_new(1);
+    CHECK(axc_diff(a, narrow, out) && axc_ulen(out) == expected);
+    CHECK(!axc_equal(a, narrow));
+    axc_destroy(narrow);
+    axc_destroy(a);
+    axc_destroy(b);
+    axc_destroy(out);
+}
+
+static void *failingRealloc(void *ptr, size_t size) {
+    (void) ptr;
+    (void) size;
+    return NULL;
+}
+
+static void testDiffOutOfMemory(void) {
+    axchunk *a = range(1000, 8);
+    axchunk *b = range(1010, 8);
+    axchunk *out = axc_newSized(sizeof(uint64_t), 1);
+    CHECK(b && out);
+    ((char *) axc_index(b, 500))[0] ^= 1;
+    uint64_t x = 42;
+    CHECK(!axc_push(out, &x));
+
+    // the output cannot grow, so nothing is appended
+    axc_memoryfn(malloc, failingRealloc, free);
+    const bool failed = axc_diff(a, b, out);
+    axc_memoryfn(malloc, realloc, free);
+    CHECK(failed && axc_ulen(out) == 1 && *(uint64_t *) axc_index(out, 0) == 42);
+    CHECK(!axc_diff(a, b, out) && axc_ulen(out) == 12);
+    axc_destroy(a);
+    axc_destroy(b);
+    axc_destroy(out);
+}
+
+/*
+ * Takes the dirty blocks and checks that they are exactly the expected ones.
+ */
+static void checkDirty(axchunk *c, const uint64_t *expected, uint64_t n) {
+    axchunk *blocks = axc_new(sizeof(uint64_t));
+    CHECK(blocks && !axc_takeDirty(c, blocks));
+    CHECK(axc_ulen(blocks) == n);
+    for (uint64_t k = 0; k < n; ++k)
+        CHECK(*(uint64_t *) axc_index(blocks, k) == expected[k]);
+    axc_destroy(blocks);
+}
+
+static bool notSixHundred(const void *x, void *arg) {
+    (void) arg;
+    return *(const uint64_t *) x != 600;
+}
+
+static void testDirtyTracking(void) {
+    axchunk *c = range(1000, 8);
+    axchunk *blocks = axc_new(sizeof(uint64_t));
+    CHECK(axc_takeDirty(c, blocks));
+    axc_destroy(blocks);
+    CHECK(!axc_trackDirty(c, 100));
+    CHECK(axc_dirtyBlockLen(c) == 128);
+    checkDirty(c, NULL, 0);
+
+    // as wide as the widest chunk the inline copies specialise for, so that the compiler sees no overread
+    uint64_t x[2] = {5};
+    CHECK(!axc_set(c, 130, x) && !axc_push(c, x));
+    axc_swap(c, 0, 999);
+    checkDirty(c, (const uint64_t[]) {0, 1, 7}, 3);
+    checkDirty(c, NULL, 0);
+
+    uint64_t many[300] = {0};
+    CHECK(!axc_write(c, 250, many, 300));
+    checkDirty(c, (const uint64_t[]) {1, 2, 3, 4}, 4);
+
+    // growing past the capacity keeps tracking, and a compaction dirties everything after the first removed chunk
+    for (uint64_t i = 0; i < 2000; ++i)
+        CHECK(!axc_push(c, &i));
+    checkDirty(c, (const uint64_t[]) {7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23}, 17);
+    axc_filter(c, notSixHundred, NULL);
+    checkDirty(c, (const uint64_t[]) {4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23}, 20);
+    CHECK(!axc_trackDirty(c, 0) && !axc_dirtyBlockLen(c));
+    axc_destroy(c);
+}
+
+int main(void) {
+    const uint64_t widths[] = {1, 2, 4, 8, 16, 3, 24, 33};
+    for (int k = 0; k < 8; ++k)
+        checkHash(widths[k]);
+    checkFingerprint(0, 8);
+    checkFingerprint(1000, 8);
+    // large enough to be hashed on several threads
+    checkFingerprint(300000, 16);
+    checkFingerprint(100000, 33);
+    checkDiff(0, 8, 1);
+    checkDiff(1000, 8, 1);
+    checkDiff(1000, 24, 1);
+    // large enough to be compared on several threads
+    checkDiff(300000, 16, 4);
+    checkDiff(100000, 33, 4);
+    testDiffOutOfMemory();
+    testDirtyTracking();
+    return 0;
+}
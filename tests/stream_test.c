@@ -0,0 +1,68 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "axcstream.h"
+#include "check.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static void testRoundTrip(bool async) {
+    int fd = open("stream.bin", O_RDWR | O_CREAT | O_TRUNC, 0600);
+    CHECK(fd >= 0);
+    axcstream *s = axcs_new(fd, sizeof(uint64_t), 64, async);
+    CHECK(s);
+    uint64_t next = 0;
+    for (; next < 1000; ++next)
+        CHECK(!axcs_push(s, &next));
+    uint64_t many[500];
+    for (int round = 0; round < 3; ++round) {
+        // small writes are buffered, large ones bypass the buffer
+        const uint64_t n = round == 1 ? 500 : 37;
+        for (uint64_t k = 0; k < n; ++k)
+            many[k] = next++;
+        CHECK(!axcs_write(s, many, n));
+    }
+    CHECK(!axcs_destroy(s));
+
+    CHECK(lseek(fd, 0, SEEK_END) == (off_t) (next * sizeof(uint64_t)));
+    for (uint64_t i = 0; i < next; ++i) {
+        uint64_t x;
+        CHECK(pread(fd, &x, sizeof x, (off_t) (i * sizeof x)) == sizeof x && x == i);
+    }
+    close(fd);
+    unlink("stream.bin");
+}
+
+static void testStickyError(bool async) {
+    int fd = open("/dev/null", O_RDONLY);
+    CHECK(fd >= 0);
+    axcstream *s = axcs_new(fd, sizeof(uint64_t), 8, async);
+    CHECK(s);
+    bool failed = false;
+    for (uint64_t i = 0; i < 64 && !failed; ++i)
+        failed = axcs_push(s, &i);
+    failed = axcs_flush(s) || failed;
+    CHECK(failed && axcs_error(s) == EBADF);
+
+    // nothing is buffered after the failure
+    const uint64_t buffered = axcs_buffered(s);
+    uint64_t x = 0;
+    for (int i = 0; i < 100; ++i)
+        CHECK(axcs_push(s, &x));
+    CHECK(axcs_write(s, &x, 1));
+    CHECK(axcs_buffered(s) == buffered);
+    CHECK(axcs_destroy(s));
+    close(fd);
+}
+
+int main(void) {
+    testRoundTrip(false);
+    testRoundTrip(true);
+    testStickyError(false);
+    testStickyError(true);
+    return 0;
+}